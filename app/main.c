@@ -14,6 +14,21 @@ int main(int argc, char *argv[]) {
         port = argv[1];
     }
 
+    // Event loop threads (0 = one per CPU core)
+    ServerConfig server_config = cweb_default_server_config();
+    if (argc > 2) {
+        server_config.worker_count = atoi(argv[2]);
+    }
+    // Optional third argument picks the socket I/O backend
+    if (argc > 3 && strcmp(argv[3], "uring") == 0) {
+        server_config.io_backend = IO_BACKEND_URING;
+    }
+    // Fourth argument "h2" additionally accepts HTTP/2 cleartext
+    if (argc > 4 && strcmp(argv[4], "h2") == 0) {
+        server_config.http2 = true;
+    }
+    cweb_server_configure(&server_config);
+
     cweb_set_mode(CWEB_MODE_PROD);
 
     // Init Cbase FileCache
@@ -28,6 +43,14 @@ int main(int argc, char *argv[]) {
 	// root site / currently not implemented cause of an anoying error. i have to fix it first.
 	// test tite url: /home --> name == route
 	auto_routes(1);
+
+	// Rendered pages that rarely change are kept for 10s and served stale for 30s more
+	char *cached_pages[] = { "/onek", "/fivek", "/tenk", "/fiftyk", "/hundredk", "/twohundredk", "/cwagger" };
+	for (size_t i = 0; i < sizeof(cached_pages) / sizeof(cached_pages[0]); i++) {
+		cweb_set_route_cache(cached_pages[i], 10, 30, NULL);
+	}
+	// Concurrent visitors share one round of upstream fetches
+	cweb_set_route_coalesce("/datahub", true, NULL);
     // cweb_set_fallback_handler(home_page);
 	// cweb_add_route("/", home_page, false);
 	// cweb_add_route("/fetch", fetch_page, false);
@@ -131,7 +131,7 @@ static void datahub_completion_cb(const AsyncAggregatedData *data, void *user_da
         res->body = strdup("<h1>Internal Server Error</h1><p>Unable to allocate buffer.</p>");
         res->body_len = strlen(res->body);
         cweb_add_response_header(res, "Content-Type", "text/html; charset=utf-8");
-        res->state = PROCESSED;
+        cweb_response_complete(res);
         datahub_context_free(ctx);
         return;
     }
@@ -157,7 +157,7 @@ static void datahub_completion_cb(const AsyncAggregatedData *data, void *user_da
         res->body = strdup("<h1>Internal Server Error</h1><p>Unable to allocate body.</p>");
         res->body_len = strlen(res->body);
         cweb_add_response_header(res, "Content-Type", "text/html; charset=utf-8");
-        res->state = PROCESSED;
+        cweb_response_complete(res);
         datahub_context_free(ctx);
         return;
     }
@@ -170,7 +170,7 @@ static void datahub_completion_cb(const AsyncAggregatedData *data, void *user_da
     res->body = body;
     res->body_len = len;
     cweb_add_response_header(res, "Content-Type", "text/html; charset=utf-8");
-    res->state = PROCESSED;
+    cweb_response_complete(res);
 
     datahub_context_free(ctx);
 }
@@ -181,15 +181,6 @@ static const char *get_env_or_default(const char *name, const char *fallback) {
 }
 
 void datahub_page(Request *req, Response *res) {
-    if (strcmp(req->method, "GET") != 0) {
-        res->status_code = 405;
-        res->body = "Method not allowed";
-        res->body_len = strlen(res->body);
-        cweb_add_response_header(res, "Content-Type", "text/plain");
-        res->state = PROCESSED;
-        return;
-    }
-
     DatahubContext *ctx = calloc(1, sizeof(*ctx));
     if (!ctx) {
         res->status_code = 500;
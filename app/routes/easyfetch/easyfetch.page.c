@@ -114,6 +114,7 @@ cleanup:
     if (res) {
         res->async_data = NULL;
         res->async_cancel = NULL;
+        cweb_response_complete(res);
     }
     cweb_speedbench_end(request);
 
@@ -141,15 +142,6 @@ void easyfetch_page(Request *req, Response *res) {
     fetch_data_t *data = malloc(sizeof(fetch_data_t));
     memset(data, 0, sizeof(fetch_data_t));
 
-    if (strcmp(req->method, "POST") == 0) { 
-        res->status_code = 403;
-        res->body = "Method not allowed";
-        res->body_len = strlen(res->body);
-        cweb_add_response_header(res, "Content-Type", "text/plain");
-        res->state = PROCESSED;
-        return;
-    }
-
     /* create small context to hand both the fetch data and Response* to the
      * callback (keeps fetch API unchanged). The callback frees this wrapper. */
     github_cb_ctx_t *ctx = malloc(sizeof(*ctx));
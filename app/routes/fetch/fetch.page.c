@@ -6,9 +6,11 @@
 #include <event2/event.h>
 #include <cweb/server.h>
 
-// Global variables for async handling
-static fetch_data_t *g_data = NULL;
-static Response *g_response = NULL;
+// One per request, the callback may run while other requests are in flight
+typedef struct {
+    fetch_data_t data;
+    Response *response;
+} FetchPageContext;
 
 void fetch_page_assets() {
    
@@ -24,7 +26,9 @@ REGISTER_FRONTEND_ASSET(fetch_page_assets);
 
 void github_response_callback(fetch_request_t *request, fetch_response_t *response, void *user_data) {
     LOG_DEBUG("FETCH_PAGE", "GitHub API response received in callback");
-    fetch_data_t *data = (fetch_data_t *)user_data;
+    FetchPageContext *ctx = user_data;
+    fetch_data_t *data = &ctx->data;
+    Response *res = ctx->response;
     
     if (fetch_response_get_status(response) == 200) {
         const fetch_json_t *json = fetch_response_get_json(response);
@@ -75,10 +79,10 @@ void github_response_callback(fetch_request_t *request, fetch_response_t *respon
     char *html = fetch_template(data);
 
     // Set response
-    g_response->status_code = 200;
-    g_response->body = html;
-    g_response->body_len = strlen(html);
-    cweb_add_response_header(g_response, "Content-Type", "text/html");
+    res->status_code = 200;
+    res->body = html;
+    res->body_len = strlen(html);
+    cweb_add_response_header(res, "Content-Type", "text/html");
     
     // Clean up request
     fetch_request_destroy(request);
@@ -88,23 +92,14 @@ void github_response_callback(fetch_request_t *request, fetch_response_t *respon
     free(data->avatar_url);
     free(data->html_url);
     free(data->type);
+    free(ctx);
     
-    g_response->state = PROCESSED;
+    cweb_response_complete(res);
 
     LOG_DEBUG("FETCH_PAGE", "Response successfully fetched and processed");
 }
 
 void fetch_page(Request *req, Response *res) {
-    if (strcmp(req->method, "POST") == 0) { 
-        LOG_DEBUG("FETCH_PAGE", "POST method not allowed for fetch page");
-        res->status_code = 403;
-        res->body = "Method not allowed";
-        res->isliteral = 1;
-        res->body_len = strlen(res->body);
-        cweb_add_response_header(res, "Content-Type", "text/plain");
-        res->state = PROCESSED;
-        return;
-    }
     
     if (fetch_global_init() != FETCH_OK) {
         LOG_DEBUG("FETCH_PAGE", "Failed to initialize fetch library");
@@ -133,12 +128,19 @@ void fetch_page(Request *req, Response *res) {
         return;
     }
     
-    fetch_data_t *data = malloc(sizeof(fetch_data_t));
-    memset(data, 0, sizeof(fetch_data_t));
-    
-    // Set global variables for callback
-    g_data = data;
-    g_response = res;
+    FetchPageContext *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) {
+        res->status_code = 500;
+        res->body = "Internal server error";
+        res->isliteral = 1;
+        res->body_len = strlen(res->body);
+        cweb_add_response_header(res, "Content-Type", "text/plain");
+        res->state = PROCESSED;
+        fetch_client_destroy(client);
+        fetch_global_cleanup();
+        return;
+    }
+    ctx->response = res;
     
     // Create GitHub API request (using octocat as example)
     fetch_request_t *request = fetch_request_create(client, FETCH_GET, "https://api.github.com/users/octocat");
@@ -150,7 +152,7 @@ void fetch_page(Request *req, Response *res) {
         res->body_len = strlen(res->body);
         cweb_add_response_header(res, "Content-Type", "text/plain");
         res->state = PROCESSED;
-        free(data);
+        free(ctx);
         fetch_client_destroy(client);
         fetch_global_cleanup();
         return;
@@ -161,7 +163,7 @@ void fetch_page(Request *req, Response *res) {
     fetch_request_set_header(request, "User-Agent", "CWeb-Framework/1.0");
     
     // Set callback
-    fetch_request_set_callback(request, github_response_callback, data);
+    fetch_request_set_callback(request, github_response_callback, ctx);
     
     // Execute request
     if (fetch_request_execute(request) != FETCH_OK) {
@@ -173,7 +175,7 @@ void fetch_page(Request *req, Response *res) {
         cweb_add_response_header(res, "Content-Type", "text/plain");
         res->state = PROCESSED;
         fetch_request_destroy(request);
-        free(data);
+        free(ctx);
         fetch_client_destroy(client);
         fetch_global_cleanup();
         return;
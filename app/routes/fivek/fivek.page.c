@@ -2,14 +2,6 @@
 
 void fivek_page(Request *req, Response *res) {
 
- if (strcmp(req->method, "POST") == 0) { 
-         res->status_code = 403;
-         res->body = "Method not allowed";
-         res->body_len = strlen(res->body);
-         cweb_add_response_header(res, "Content-Type", "text/plain");
-         return;
- }
-
          res->status_code = 200;
          res->body = template_fivek();
         res->body_len = strlen(res->body);
@@ -15,14 +15,6 @@ void speedtest_page_assets() {
 REGISTER_FRONTEND_ASSET(speedtest_page_assets);
 
 void speedtest_page(Request *req, Response *res) {
-    if (strcmp(req->method, "POST") == 0) { 
-        res->status_code = 403;
-        res->body = "Method not allowed";
-        res->body_len = strlen(res->body);
-        cweb_add_response_header(res, "Content-Type", "text/plain; charset=utf-8");
-        return;
-    }
-
     LOG_INFO("SPEEDTEST", "speed benchmark: %s", req->path);
 
     size_t out_count = 0;
@@ -0,0 +1,170 @@
+// Keep-alive load generator to compare the server's I/O backends.
+//
+//   gcc -O2 -o benchserver benchserver.c
+//   ./app 8080 1             &   ./benchserver 8080 /helloworld 64 10
+//   ./app 8080 1 uring       &   ./benchserver 8080 /helloworld 64 10
+//
+// Opens <connections> sockets to 127.0.0.1:<port>, keeps <pipeline> GETs in
+// flight on each and reports requests/s and mean latency after <seconds>.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define READ_CHUNK 65536
+
+typedef struct {
+    int fd;
+    char *buf;          // Unparsed response bytes
+    size_t len;
+    size_t cap;
+    int outstanding;    // Requests sent, response not complete yet
+    double sent_at[64]; // Send time per outstanding request
+    int sent_head;
+} Client;
+
+static const char *request;
+static size_t request_len;
+static int pipeline = 1;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sin = {0};
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+static void send_requests(Client *c) {
+    while (c->outstanding < pipeline) {
+        if (write(c->fd, request, request_len) != (ssize_t)request_len) {
+            perror("write");
+            exit(1);
+        }
+        c->sent_at[(c->sent_head + c->outstanding) % 64] = now_sec();
+        c->outstanding++;
+    }
+}
+
+// Length of the first complete response in buf, 0 if it is not complete yet
+static size_t response_length(const char *buf, size_t len) {
+    const char *end = memmem(buf, len, "\r\n\r\n", 4);
+    if (!end) return 0;
+    size_t head = (size_t)(end - buf) + 4;
+    size_t body = 0;
+    const char *cl = memmem(buf, head, "Content-Length:", 15);
+    if (cl) body = strtoul(cl + 15, NULL, 10);
+    return head + body <= len ? head + body : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <port> <path> <connections> <seconds> [pipeline]\n", argv[0]);
+        return 1;
+    }
+    int port = atoi(argv[1]);
+    int connections = atoi(argv[3]);
+    double seconds = atof(argv[4]);
+    if (argc > 5) pipeline = atoi(argv[5]);
+    if (connections < 1 || pipeline < 1 || pipeline > 64) {
+        fprintf(stderr, "connections must be >= 1, pipeline 1..64\n");
+        return 1;
+    }
+
+    char *req = NULL;
+    if (asprintf(&req, "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", argv[2]) < 0) return 1;
+    request = req;
+    request_len = strlen(req);
+
+    int ep = epoll_create1(0);
+    Client *clients = calloc(connections, sizeof(Client));
+    for (int i = 0; i < connections; i++) {
+        Client *c = &clients[i];
+        c->fd = connect_to(port);
+        c->cap = READ_CHUNK * 2;
+        c->buf = malloc(c->cap);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+        send_requests(c);
+    }
+
+    unsigned long completed = 0;
+    double latency = 0;
+    double start = now_sec();
+    double deadline = start + seconds;
+    struct epoll_event events[256];
+
+    while (now_sec() < deadline) {
+        int n = epoll_wait(ep, events, 256, 100);
+        for (int i = 0; i < n; i++) {
+            Client *c = events[i].data.ptr;
+            for (;;) {
+                if (c->cap - c->len < READ_CHUNK) {
+                    c->cap *= 2;
+                    c->buf = realloc(c->buf, c->cap);
+                }
+                ssize_t r = read(c->fd, c->buf + c->len, c->cap - c->len);
+                if (r == 0) {
+                    fprintf(stderr, "Server closed a connection\n");
+                    return 1;
+                }
+                if (r < 0) {
+                    if (errno == EAGAIN) break;
+                    perror("read");
+                    return 1;
+                }
+                c->len += (size_t)r;
+            }
+
+            size_t used = 0, one;
+            double t = now_sec();
+            while ((one = response_length(c->buf + used, c->len - used)) > 0) {
+                used += one;
+                latency += t - c->sent_at[c->sent_head];
+                c->sent_head = (c->sent_head + 1) % 64;
+                c->outstanding--;
+                completed++;
+            }
+            memmove(c->buf, c->buf + used, c->len - used);
+            c->len -= used;
+            send_requests(c);
+        }
+    }
+
+    double elapsed = now_sec() - start;
+    printf("%lu requests in %.2fs: %.0f req/s, mean latency %.3f ms\n",
+           completed, elapsed, completed / elapsed,
+           completed ? latency / completed * 1000.0 : 0.0);
+
+    for (int i = 0; i < connections; i++) {
+        close(clients[i].fd);
+        free(clients[i].buf);
+    }
+    free(clients);
+    free(req);
+    close(ep);
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Full versus resumed TLS handshakes against the server's HTTPS listener.
+//
+//   openssl req -x509 -newkey rsa:2048 -nodes -keyout key.pem -out cert.pem -subj /CN=localhost
+//   gcc -O2 -o benchtls benchtls.c -lssl -lcrypto
+//   (tls_cert_file = "cert.pem", tls_key_file = "key.pem" in ServerConfig)
+//   ./benchtls 8080 /helloworld 2000            (TLS 1.3)
+//   ./benchtls 8080 /helloworld 2000 tls1.2
+//
+// Runs <connections> sequential connections twice, each doing the handshake
+// and one GET: first without a session, then presenting the session (ticket)
+// the previous connection received. Reports handshakes/s and mean handshake
+// time for both runs.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sin = {0};
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Reads until the response head and Content-Length body are in, 0 on success
+static int read_response(SSL *ssl) {
+    char buf[65536];
+    size_t len = 0;
+    for (;;) {
+        int r = SSL_read(ssl, buf + len, (int)(sizeof(buf) - len - 1));
+        if (r <= 0) return -1;
+        len += (size_t)r;
+        buf[len] = '\0';
+        const char *end = strstr(buf, "\r\n\r\n");
+        if (!end) {
+            if (len == sizeof(buf) - 1) return -1;
+            continue;
+        }
+        size_t head = (size_t)(end - buf) + 4;
+        const char *cl = strcasestr(buf, "Content-Length:");
+        size_t body = cl ? strtoul(cl + 15, NULL, 10) : 0;
+        // Body may not fit, drain it without keeping it
+        while (len < head + body) {
+            size_t want = head + body - len;
+            r = SSL_read(ssl, buf, want < sizeof(buf) ? (int)want : (int)sizeof(buf));
+            if (r <= 0) return -1;
+            len += (size_t)r;
+        }
+        return 0;
+    }
+}
+
+typedef struct {
+    int done;
+    int reused;
+    double handshake; // Seconds spent in SSL_connect
+    double elapsed;
+} RunResult;
+
+static RunResult run(SSL_CTX *ctx, int port, const char *request, int connections, int resume) {
+    RunResult result = {0};
+    SSL_SESSION *session = NULL;
+    double start = now_sec();
+    for (int i = 0; i < connections; i++) {
+        int fd = connect_to(port);
+        SSL *ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, fd);
+        SSL_set_tlsext_host_name(ssl, "localhost");
+        if (resume && session) SSL_set_session(ssl, session);
+
+        double t = now_sec();
+        if (SSL_connect(ssl) != 1) {
+            ERR_print_errors_fp(stderr);
+            exit(1);
+        }
+        result.handshake += now_sec() - t;
+        if (SSL_session_reused(ssl)) result.reused++;
+
+        if (SSL_write(ssl, request, (int)strlen(request)) <= 0 || read_response(ssl) != 0) {
+            fprintf(stderr, "Request %d failed\n", i);
+            exit(1);
+        }
+        // TLS 1.3 tickets arrive after the handshake, so take the session
+        // only once the response has been read
+        if (resume) {
+            SSL_SESSION *next = SSL_get1_session(ssl);
+            if (next) {
+                if (session) SSL_SESSION_free(session);
+                session = next;
+            }
+        }
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        close(fd);
+        result.done++;
+    }
+    result.elapsed = now_sec() - start;
+    if (session) SSL_SESSION_free(session);
+    return result;
+}
+
+static void report(const char *name, RunResult r) {
+    printf("%-8s %d connections in %.2fs: %.0f conn/s, mean handshake %.3f ms, %d resumed\n",
+           name, r.done, r.elapsed, r.done / r.elapsed,
+           r.done ? r.handshake / r.done * 1000.0 : 0.0, r.reused);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <port> <path> <connections> [tls1.2]\n", argv[0]);
+        return 1;
+    }
+    int port = atoi(argv[1]);
+    int connections = atoi(argv[3]);
+    if (connections < 1) {
+        fprintf(stderr, "connections must be >= 1\n");
+        return 1;
+    }
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (argc > 4 && strcmp(argv[4], "tls1.2") == 0) {
+        SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    }
+    // Self-signed test certificate
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT);
+
+    char *request = NULL;
+    if (asprintf(&request, "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n", argv[2]) < 0) return 1;
+
+    report("full", run(ctx, port, request, connections, 0));
+    report("resumed", run(ctx, port, request, connections, 1));
+
+    free(request);
+    SSL_CTX_free(ctx);
+    return 0;
+}
@@ -11,6 +11,8 @@
 #include <string.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <ctype.h>
+#include <stdbool.h>
 
 int handle_build_command(int argc, char *argv[]);
 
@@ -213,6 +215,103 @@ int write_build_h(size_t num_lists, ...) {
 }
 
 
+// Page name taken from "<name>.page.c"
+#define ROUTE_NAME_MAX 256
+
+typedef struct {
+    char path[1 + ROUTE_NAME_MAX];             // "/" + name
+    size_t len;
+    char handler[ROUTE_NAME_MAX + sizeof("_page") - 1]; // name + "_page"
+} static_route_t;
+
+// By length, so the routes of one switch case are adjacent
+static int compare_static_routes(const void *a, const void *b) {
+    const static_route_t *x = a;
+    const static_route_t *y = b;
+    if (x->len != y->len) return x->len < y->len ? -1 : 1;
+    return strcmp(x->path, y->path);
+}
+
+// Byte position that tells most of the equally long routes apart
+static size_t pick_switch_index(const static_route_t *group, size_t count) {
+    size_t best = 0;
+    size_t best_distinct = 0;
+    for (size_t i = 0; i < group[0].len; i++) {
+        bool seen[256] = {false};
+        size_t distinct = 0;
+        for (size_t j = 0; j < count; j++) {
+            unsigned char c = (unsigned char)group[j].path[i];
+            if (!seen[c]) {
+                seen[c] = true;
+                distinct++;
+            }
+        }
+        if (distinct > best_distinct) {
+            best = i;
+            best_distinct = distinct;
+        }
+    }
+    return best;
+}
+
+static void write_case_label(FILE *file, unsigned char c) {
+    if (isalnum(c) || c == '_' || c == '-' || c == '.' || c == '/') {
+        fprintf(file, "        case '%c':\n", c);
+    } else {
+        fprintf(file, "        case %u:\n", c);
+    }
+}
+
+// Switch on the length, then on the most telling byte, then one memcmp.
+// Every route of app/routes is a fixed path, so this covers them all and
+// the runtime router only sees routes added by code. Pages answer GET (and
+// with it HEAD), the router answers OPTIONS and 405 for them.
+static void write_static_dispatch(FILE *file, const static_route_t *routes, size_t count) {
+    fprintf(file, "static Route auto_route_table[] = {\n");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file, "    { .path = \"%s\", .method_handlers = { [CWEB_METHOD_GET] = %s } },\n", routes[i].path, routes[i].handler);
+    }
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "static Route *auto_route_lookup(const char *path, size_t len) {\n");
+    fprintf(file, "    switch (len) {\n");
+    for (size_t start = 0; start < count;) {
+        size_t end = start;
+        while (end < count && routes[end].len == routes[start].len) end++;
+
+        fprintf(file, "    case %zu:\n", routes[start].len);
+        if (end - start == 1) {
+            fprintf(file, "        if (memcmp(path, \"%s\", %zu) == 0) return &auto_route_table[%zu];\n",
+                    routes[start].path, routes[start].len, start);
+        } else {
+            size_t index = pick_switch_index(&routes[start], end - start);
+            fprintf(file, "        switch (path[%zu]) {\n", index);
+            for (size_t i = start; i < end; i++) {
+                unsigned char c = (unsigned char)routes[i].path[index];
+                bool labelled = false;
+                for (size_t j = start; j < i; j++) {
+                    if ((unsigned char)routes[j].path[index] == c) labelled = true;
+                }
+                if (labelled) continue;
+
+                write_case_label(file, c);
+                for (size_t j = i; j < end; j++) {
+                    if ((unsigned char)routes[j].path[index] != c) continue;
+                    fprintf(file, "            if (memcmp(path, \"%s\", %zu) == 0) return &auto_route_table[%zu];\n",
+                            routes[j].path, routes[j].len, j);
+                }
+                fprintf(file, "            break;\n");
+            }
+            fprintf(file, "        }\n");
+        }
+        fprintf(file, "        break;\n");
+        start = end;
+    }
+    fprintf(file, "    }\n");
+    fprintf(file, "    return NULL;\n");
+    fprintf(file, "}\n\n");
+}
+
 int generate_auto_routes(const char *routes_dir, const char *output_file) {
     file_list_t route_files = {0};
 
@@ -229,31 +328,62 @@ int generate_auto_routes(const char *routes_dir, const char *output_file) {
         return -1;
     }
 
-    fprintf(file, "#include \"build.h\"\n\n");
-    fprintf(file, "void auto_routes(int toggle) {\n");
-    fprintf(file, "    if (!toggle) return;\n\n");
+    static_route_t *routes = calloc(route_files.count ? route_files.count : 1, sizeof(*routes));
+    if (!routes) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        fclose(file);
+        cleanup_file_list(&route_files);
+        return -1;
+    }
+    size_t route_count = 0;
 
-    // Genriere add_route-Aufrufe für jede gefundene Datei
+    // Route und Handler für jede gefundene Datei
    	for (size_t i = 0; i < route_files.count; i++) {
 		const char *file_path = route_files.files[i];
 		const char *basename = strrchr(file_path, '/');
 		basename = basename ? basename + 1 : file_path;
 	
 		// Entferne die letzten 7 Zeichen (".page.c")
-		char route_name[256];
+		char route_name[ROUTE_NAME_MAX];
 		snprintf(route_name, sizeof(route_name), "%s", basename);
 		size_t len = strlen(route_name);
 		if (len > 7) {
 			route_name[len - 7] = '\0'; // Entferne die letzten 7 Zeichen
 		}
 	
-		fprintf(file, "    cweb_add_route(\"/%s\", %s_page, false);\n", route_name, route_name);
+		static_route_t *route = &routes[route_count];
+		snprintf(route->path, sizeof(route->path), "/%s", route_name);
+		snprintf(route->handler, sizeof(route->handler), "%s_page", route_name);
+		route->len = strlen(route->path);
+
+		bool duplicate = false;
+		for (size_t j = 0; j < route_count; j++) {
+			if (strcmp(routes[j].path, route->path) == 0) duplicate = true;
+		}
+		if (duplicate) {
+			fprintf(stderr, "Warning: Route %s exists twice, skipping %s\n", route->path, file_path);
+			continue;
+		}
+		route_count++;
 	}
+	qsort(routes, route_count, sizeof(*routes), compare_static_routes);
 
+    fprintf(file, "#include \"build.h\"\n");
+    fprintf(file, "#include <cweb/routing.h>\n");
+    fprintf(file, "#include <string.h>\n\n");
+    if (route_count > 0) {
+        write_static_dispatch(file, routes, route_count);
+    }
+    fprintf(file, "void auto_routes(int toggle) {\n");
+    fprintf(file, "    if (!toggle) return;\n");
+    if (route_count > 0) {
+        fprintf(file, "\n    cweb_set_static_routes(auto_route_table, %zu, auto_route_lookup);\n", route_count);
+    }
     fprintf(file, "}\n");
     fclose(file);
 
     // Speicher freigeben
+    free(routes);
     cleanup_file_list(&route_files);
 
     printf("Generated auto_routes.c in '%s'\n", output_file);
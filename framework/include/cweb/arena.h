@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+#ifndef CWEB_ARENA_H
+#define CWEB_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bump allocator for memory that lives exactly as long as one request.
+// Allocations are never freed one by one, cweb_arena_release drops all of
+// them at once. Not thread safe, an arena belongs to one worker.
+
+#define CWEB_ARENA_BLOCK_SIZE 4096
+
+typedef struct CwebArenaBlock CwebArenaBlock;
+
+typedef struct {
+    CwebArenaBlock *blocks; // Most recent first
+    char *cur;              // Free space in the current block
+    char *end;
+} CwebArena;
+
+// Aligned for any type, NULL when out of memory
+void *cweb_arena_alloc(CwebArena *arena, size_t size);
+char *cweb_arena_strdup(CwebArena *arena, const char *s);
+char *cweb_arena_strndup(CwebArena *arena, const char *s, size_t len);
+// Frees every block, the arena can be used again afterwards
+void cweb_arena_release(CwebArena *arena);
+// Drops all allocations but keeps one standard block for the next user
+void cweb_arena_reset(CwebArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CWEB_ARENA_H */
@@ -9,6 +9,7 @@
 #define CWEB_FILESERVER_H
 
 #include <cweb/http.h>
+#include <cweb/compress.h>
 #include <cweb/logger.h>
 #include <cweb/autofree.h>
 #include <stddef.h>
@@ -31,6 +32,13 @@ extern "C" {
 #define MAX_MIME_TYPE 64
 #define MAX_CACHED_FILES 1024
 
+// A cached file as sent with one Content-Encoding
+typedef struct {
+    char *data;                // Minified and encoded body, NULL if the encoding does not pay off
+    size_t size;
+    CwebHeaderBlock *headers;  // Content-Type, Cache-Control, Vary, Content-Encoding
+} CachedVariant;
+
 typedef struct {
     char filename[MAX_FILENAME];
     char mime_type[MAX_MIME_TYPE];
@@ -38,6 +46,7 @@ typedef struct {
     size_t size;
     time_t last_modified;
     bool is_loaded;
+    CachedVariant variants[COMP_GZIP + 1]; // Indexed by CompressionType, built when the file is loaded
 } CachedFile;
 
 // File serving modes
@@ -85,6 +94,7 @@ void cweb_fileserver_handle_request(Request *req, Response *res);
 bool cweb_fileserver_is_static_file(const char *path);
 int cweb_serve_from_filesystem(const char *filepath, Response *res);
 int cweb_serve_from_memory(const char *path, Response *res);
+void cweb_fileserver_release_open_files(void); // Per worker thread, on shutdown
 
 /* Utility functions (mostly used internally, but exposed for advanced cases) */
 const char* cweb_get_mime_type(const char *filename);
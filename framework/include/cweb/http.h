@@ -8,8 +8,10 @@
 #define CWEB_HTTP_H
 
 #include <cweb/leak_detector.h>
+#include <cweb/arena.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <cweb/session.h>
 
 
@@ -20,10 +22,54 @@ extern "C" {
 #define MAX_HEADERS 64
 #define MAX_PATH_LEN 2048
 #define READ_BUFFER_SIZE 8192
+#define INLINE_HEADERS 8    // Header slots inside Request/Response before they grow
+
+// Header names the framework knows, recognized once when a header is stored
+typedef enum {
+    CWEB_HEADER_UNKNOWN = 0,
+    CWEB_HEADER_ACCEPT,
+    CWEB_HEADER_ACCEPT_ENCODING,
+    CWEB_HEADER_ACCEPT_LANGUAGE,
+    CWEB_HEADER_AUTHORIZATION,
+    CWEB_HEADER_CACHE_CONTROL,
+    CWEB_HEADER_CONNECTION,
+    CWEB_HEADER_CONTENT_ENCODING,
+    CWEB_HEADER_CONTENT_LENGTH,
+    CWEB_HEADER_CONTENT_TYPE,
+    CWEB_HEADER_COOKIE,
+    CWEB_HEADER_DATE,
+    CWEB_HEADER_ETAG,
+    CWEB_HEADER_EXPECT,
+    CWEB_HEADER_EXPIRES,
+    CWEB_HEADER_HOST,
+    CWEB_HEADER_HTTP2_SETTINGS,
+    CWEB_HEADER_IF_MODIFIED_SINCE,
+    CWEB_HEADER_IF_NONE_MATCH,
+    CWEB_HEADER_KEEP_ALIVE,
+    CWEB_HEADER_LAST_MODIFIED,
+    CWEB_HEADER_LINK,
+    CWEB_HEADER_LOCATION,
+    CWEB_HEADER_ORIGIN,
+    CWEB_HEADER_PROXY_CONNECTION,
+    CWEB_HEADER_RANGE,
+    CWEB_HEADER_REFERER,
+    CWEB_HEADER_SERVER,
+    CWEB_HEADER_SET_COOKIE,
+    CWEB_HEADER_TRANSFER_ENCODING,
+    CWEB_HEADER_UPGRADE,
+    CWEB_HEADER_USER_AGENT,
+    CWEB_HEADER_VARY,
+    CWEB_HEADER_X_CONTENT_TYPE_OPTIONS,
+    CWEB_HEADER_COUNT
+} HeaderId;
 
 typedef struct {
-    char *key;
+    char *key;        // Interned (shared, never freed) when id is a known header
     char *value;
+    HeaderId id;
+    uint32_t hash;    // Case-insensitive hash of key, compared before the key itself
+    uint32_t key_len;
+    uint32_t value_len;
 } Header;
 
 typedef enum {
@@ -33,46 +79,175 @@ typedef enum {
     ERROR             // Fehler aufgetreten (z.B. bei fetch-Fehler)
 } ResponseState;
 
+// Methods of RFC 9110 section 9, identified once with the request line
+typedef enum {
+    CWEB_METHOD_UNKNOWN = 0, // Extension method, see req->method
+    CWEB_METHOD_GET,
+    CWEB_METHOD_HEAD,
+    CWEB_METHOD_POST,
+    CWEB_METHOD_PUT,
+    CWEB_METHOD_DELETE,
+    CWEB_METHOD_CONNECT,
+    CWEB_METHOD_OPTIONS,
+    CWEB_METHOD_TRACE,
+    CWEB_METHOD_PATCH,
+    CWEB_METHOD_COUNT
+} HttpMethod;
+
+// Most ":name" and "*name" captures a route pattern may have
+#define CWEB_MAX_ROUTE_PARAMS 8
+
+// One path parameter of the matched route
+typedef struct {
+    const char *name;  // From the route pattern, lives as long as the route
+    const char *value; // Slice of req->path, neither NUL-terminated nor percent-decoded
+    size_t value_len;
+} RouteParam;
+
+struct Route;
+
+// Fields every request touches come first, the inline header slots last.
 typedef struct {
     char method[16];
-    char path[MAX_PATH_LEN];
-    char version[16];
-    Header headers[MAX_HEADERS];
+    HttpMethod method_id;
+    const char *path;   // NUL-terminated, in the arena (at most MAX_PATH_LEN - 1 bytes)
+    size_t path_len;
+    Header *headers;    // inline_headers, or arena memory once more than INLINE_HEADERS arrive
     int header_count;
-    char *body;
-    char *session_id; // Extracted from cookie
+    int header_capacity;
+    uint8_t header_index[CWEB_HEADER_COUNT]; // 1 + position of the first header per id, 0 = absent
+    char version[16];
+    char *body;       // Buffered request body (NUL-terminated), NULL if streamed or empty
+    size_t body_len;
+    char *session_id; // Id of req->session, set for session routes
     Session *session; // Associated session object
 	bool using_session;
+    void *body_ctx;   // Free for use by a streaming body handler
+    struct HttpQuery *query; // Query parameters, parsed by the first cweb_get_query* call (arena)
+    const struct Route *route; // Set by cweb_match_route, NULL when no route matched
+    bool route_matched;
+    int param_count;
+    struct CacheFlight *cache_flight; // Set while its response is rendered for the route cache
+    CwebArena arena;  // Header strings, cookies and cweb_request_alloc memory, released with the request
+    Header inline_headers[INLINE_HEADERS];
+    RouteParam params[CWEB_MAX_ROUTE_PARAMS]; // Captures of route, the first param_count are valid
 } Request;
 
+struct evbuffer;
+
+// Header lines shared by every response of one resource, serialized once.
+// Immutable after cweb_header_block_new, so any thread may send it.
 typedef struct {
-    int status_code;
-    const char *status_message;
-    Header headers[MAX_HEADERS];
+    Header *headers;  // Lowercase names, for lookups and HTTP/2
     int header_count;
+    uint8_t header_index[CWEB_HEADER_COUNT];
+    char *data;       // "Name: value\r\n" lines for HTTP/1
+    size_t len;
+} CwebHeaderBlock;
+
+// Status, headers and body of a stored response (route cache), shared by
+// the responses serving it and freed with the last reference. Immutable.
+typedef struct {
+    unsigned refs;    // Changed atomically
+    int status_code;
+    CwebHeaderBlock *headers;
     char *body;
     size_t body_len;
-        int priority;
-        int isliteral; // 0 = dynamic, 1 = literal/static
+} CwebSharedBody;
+
+typedef struct {
+    int status_code;
     ResponseState state;
+    char *body;
+    size_t body_len;
+    Header *headers;  // inline_headers until more than INLINE_HEADERS are added
+    int header_count;
+    int header_capacity;
+    uint8_t header_index[CWEB_HEADER_COUNT];
+    int isliteral; // 0 = dynamic, 1 = literal/static
+    int priority;
+    struct evbuffer *body_file; // File-backed body sent with sendfile instead of body (body_len still set)
+    CwebArena *arena; // Arena of the request it answers (headers live there), NULL for a standalone response
+    const CwebHeaderBlock *header_block; // Sent ahead of headers, not owned. The body is final: no minifying or compression
+    const char *status_message;
     void *async_data;
     void (*async_cancel)(void *async_data);
+    void *pending;    // Server bookkeeping while an async response is outstanding
+    CwebSharedBody *shared; // Stored response body and header_block point into, one reference held
+    Header inline_headers[INLINE_HEADERS];
 } Response;
 
 // Request lifecycle
+// head is one complete head up to and including the empty line, parsed in
+// place: headers and path point into it. 0, or the status to reject with
+// (400, 414, 431, 501, 505).
+int cweb_parse_request_head(Request *req, char *head, size_t len);
+// Same on a copy in a new request, NULL when the head is invalid
 Request* cweb_parse_request(const char *raw_request, size_t len);
+// Kernel scanning request heads: "avx2", "sse4.2" or "scalar", the widest
+// the CPU supports unless changed
+const char *cweb_http_scan_kernel(void);
+// Use another kernel (benchmarks), false if unknown or unsupported here
+bool cweb_http_use_scan_kernel(const char *name);
+Request* cweb_create_request(void);
+void cweb_add_request_header(Request *req, const char *key, const char *value);
 void cweb_free_http_request(Request *req);
+// Requests and responses are recycled per thread, this frees the calling
+// thread's spares (worker shutdown)
+void cweb_http_pool_cleanup(void);
+// Memory valid until the request is freed, nothing to release by hand
+void *cweb_request_alloc(Request *req, size_t size);
+char *cweb_request_strdup(Request *req, const char *s);
 
 // Response lifecycle
 Response* cweb_create_response();
+// Response whose headers are allocated from req's arena, free it before req
+Response* cweb_create_response_for(Request *req);
 void cweb_free_http_response(Response *res);
 char* cweb_serialize_response(Response *res, size_t *total_len);
+char* cweb_serialize_response_head(Response *res, size_t *head_len);
+// Block of res's headers (without Content-Length and Date), NULL on failure
+CwebHeaderBlock* cweb_header_block_new(const Response *res);
+void cweb_header_block_free(CwebHeaderBlock *block);
+// Copy of res's status, header block and body with one reference, NULL on failure
+CwebSharedBody* cweb_shared_body_new(const Response *res);
+void cweb_shared_body_retain(CwebSharedBody *shared);
+void cweb_shared_body_release(CwebSharedBody *shared);
+// Answers res with shared (takes a reference), the body is final as with header_block
+void cweb_response_share(Response *res, CwebSharedBody *shared);
+// Exact size of the status line and headers, and writing them to out (at
+// least that many bytes), for callers that serialize into their own buffer
+size_t cweb_response_head_length(const Response *res);
+size_t cweb_write_response_head(const Response *res, char *out);
+// Current time as an IMF-fixdate for the Date header, formatted once per second
+const char* cweb_http_date(void);
 void cweb_add_response_header(Response *res, const char *key, const char *value);
 void cweb_add_performance_headers(Response *res, const char *content_type);
 void cweb_add_preload_headers(Response *res);
 const char* cweb_get_status_message(int code);
 const char* cweb_get_request_header(const Request *req, const char *key);
+// Value of cookie name as a slice of the Cookie header (not NUL-terminated,
+// valid as long as req), false if the request has no such cookie
+bool cweb_get_cookie(const Request *req, const char *name, const char **value, size_t *value_len);
+// Query parameters of req->path, percent-decoded. The string is parsed
+// once per request, lookups are hashed. Values are slices (not
+// NUL-terminated, valid as long as req), "?flag" has an empty value.
+bool cweb_get_query(Request *req, const char *key, const char **value, size_t *value_len);
+bool cweb_has_query(Request *req, const char *key);
+// Whole value as a decimal number, default_value if absent or not a number
+long cweb_get_query_long(Request *req, const char *key, long default_value);
 const char* cweb_get_response_header(const Response *res, const char *key);
+// O(1) lookups of known headers, the string versions map key to an id first
+const char* cweb_get_request_header_id(const Request *req, HeaderId id);
+const char* cweb_get_response_header_id(const Response *res, HeaderId id);
+// Id of a header name (any case), CWEB_HEADER_UNKNOWN for custom headers
+HeaderId cweb_header_id(const char *name, size_t len);
+// Canonical spelling of a known header, "" for CWEB_HEADER_UNKNOWN
+const char* cweb_header_name(HeaderId id);
+// Id of a method name (methods are case-sensitive), CWEB_METHOD_UNKNOWN otherwise
+HttpMethod cweb_http_method(const char *name, size_t len);
+// Name of a known method, "" for CWEB_METHOD_UNKNOWN
+const char* cweb_http_method_name(HttpMethod method);
 
 #ifdef __cplusplus
 }
@@ -17,6 +17,8 @@ extern "C" {
 #define UTILS_MAX_PATH_LEN 256
 
 // 1. Pfad- und Query-Parsing
+// Die Query-Funktionen parsen bei jedem Aufruf neu, in Handlern besser
+// cweb_get_query / cweb_get_query_long (http.h) auf dem Request nutzen
 char* cweb_get_route_base(const char *path);
 char* cweb_get_query_string(char *path);
 bool cweb_has_query_param(char *path, char *key);
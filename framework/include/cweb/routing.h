@@ -18,23 +18,78 @@ extern "C" {
 // Define route_handler_t as a function pointer type if not already defined
 typedef void (*route_handler_t)(Request *req, Response *res);
 
+// Receives the request body piece by piece while it arrives, last is set on
+// the final call (data may be empty then). The route handler runs afterwards,
+// unless the body was aborted - last is still delivered so body_ctx can be freed.
+typedef void (*body_handler_t)(Request *req, const char *data, size_t len, bool last);
+
 // A route handler is a function that takes a Request and populates a Response.
 
+// path is a pattern: "/users/:id/posts/*rest" captures one segment as id
+// and the remainder of the path as rest (see cweb_get_route_param).
 // muss uberarbeiten werden, um Session-Management gsceit zu unterstutzen
-typedef struct {
+typedef struct Route {
     char *path;
-    route_handler_t handler;
+    route_handler_t handler;     // Any method without its own handler, NULL = 405
+    route_handler_t method_handlers[CWEB_METHOD_COUNT];
     bool using_session;
-	int has_dynamic_subpath;
-	int has_dynamic_param;
+	int has_dynamic_subpath; // Also matches path + "/*"
+	int has_dynamic_param;   // Kept for compatibility, the query never takes part in matching
+    body_handler_t body_handler; // NULL = body is buffered into req->body
+    int timeout;                 // Seconds a pending response may take before a 504, 0 = server default
+    int cache_ttl;               // Seconds a stored GET response is served without the handler, 0 = not cached
+    int cache_stale;             // Seconds after that it is still served while one request refreshes it
+    char *cache_query;           // Comma separated query parameters that tell cached or coalesced requests apart
+    bool coalesce;               // Identical GET requests in flight share one handler run
 } Route;
 
+// Exact-path dispatch over a route table, generated by `cweb build` for the
+// pages in app/routes. Returns the entry for path[0..len) or NULL.
+typedef Route *(*static_route_lookup_t)(const char *path, size_t len);
+
+// Consults lookup before the route tree. table stays owned by the caller,
+// its entries accept the cweb_set_* calls like added routes.
+void cweb_set_static_routes(Route *table, size_t count, static_route_lookup_t lookup);
+
 void cweb_set_fallback_handler(route_handler_t handler);
 void cweb_set_dynamic_subpath(char *path, int set_dynamic);
 void cweb_set_dynamic_param(char *path, int set_dynamic);
+void cweb_set_body_handler(char *path, body_handler_t handler);
+void cweb_set_route_timeout(char *path, int seconds);
+// Stores the rendered GET responses of path for ttl_seconds: hits are sent
+// from the stored bytes, concurrent misses wait for the first one. Only
+// 200 responses without Set-Cookie or Cache-Control no-store/private are
+// kept. They are told apart by the path, the values of query_keys (comma
+// separated, NULL = the query is ignored) and the negotiated encoding.
+// Session routes are never cached. ttl_seconds 0 turns caching off.
+void cweb_set_route_cache(char *path, int ttl_seconds, int stale_seconds, const char *query_keys);
+// Without storing anything: GET and HEAD requests on path that arrive while
+// an identical one (same key as with cweb_set_route_cache) is pending wait
+// for it and get a copy of its response, whatever the status. They run the
+// handler themselves if it sets a cookie or Cache-Control private.
+// query_keys NULL keeps the keys already set, a cached route keeps its own.
+void cweb_set_route_coalesce(char *path, bool coalesce, const char *query_keys);
 int cweb_rewriteRoutePath(char *current_path, char *new_path);
 void cweb_add_route(const char *path, route_handler_t handler, bool requires_session);
+// Handles only method on path. HEAD is served by the GET handler without
+// sending the body, OPTIONS and methods without a handler are answered by
+// the router (204 or 405 with an Allow header).
+void cweb_add_method_route(HttpMethod method, const char *path, route_handler_t handler, bool requires_session);
+// Handler of route for req->method_id, one of the router's own for OPTIONS and 405
+route_handler_t cweb_route_handler(const Route *route, const Request *req);
 route_handler_t cweb_get_route_handler(const char *path, bool *requires_session);
+body_handler_t cweb_get_body_handler(const char *path);
+int cweb_get_route_timeout(const char *path);
+route_handler_t cweb_get_fallback_handler(void);
+
+// Route for req->path (query ignored), matched once per request. Fills
+// req->params with its captures. Routes must not change while serving.
+const Route *cweb_match_route(Request *req);
+
+// Path parameter of the matched route as a slice of req->path
+bool cweb_get_route_param(Request *req, const char *name, const char **value, size_t *value_len);
+// Path parameter parsed as a decimal number, default_value if absent or malformed
+long cweb_get_route_param_long(Request *req, const char *name, long default_value);
 void cweb_clear_routes();
 
 #ifdef __cplusplus
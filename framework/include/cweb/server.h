@@ -13,6 +13,7 @@
 #include <cweb/http.h>
 #include <cweb/routing.h>
 #include <cweb/logger.h>
+#include <cweb/thread_local.h>
 
 #include <string.h>
 #include <stdlib.h>
@@ -28,25 +29,58 @@
 extern "C" {
 #endif
 
-extern struct event_base *g_event_base;
+// Event base of the worker loop running on the calling thread.
+extern CWEB_THREAD_LOCAL struct event_base *g_event_base;
 #define AUTOFREE_EVENT __attribute__((cleanup(cleanup_free_event)))
 
+#define CWEB_MAX_WORKERS 64
+
+// Socket I/O underneath the connections
+typedef enum {
+    IO_BACKEND_LIBEVENT = 0,    // bufferevent sockets (default)
+    IO_BACKEND_URING            // io_uring accept/recv/send (Linux 6.0+), falls back to libevent
+} IoBackend;
+
+// Server configuration (set before cweb_run_server)
+typedef struct {
+    int worker_count;           // Event loop threads, 0 = one per online CPU
+    int keep_alive_timeout;     // Idle seconds before a persistent connection is closed, 0 = no keep-alive
+    int max_pipelined_requests; // Requests in flight per connection before reading pauses
+    size_t max_body_size;       // Largest buffered request body in bytes (413 above), streamed bodies are not limited
+    size_t max_header_size;     // Largest request head in bytes (431 above)
+    int max_connections;        // Open connections across all workers, 0 = unlimited
+    int read_timeout;           // Seconds a started request may stall between reads, 0 = none
+    int write_timeout;          // Seconds pending output may stall, 0 = none
+    int header_timeout;         // Seconds to deliver a complete request head (408 after), 0 = none
+    size_t output_high_watermark; // Stop reading new requests above this many queued output bytes, 0 = off
+    int async_timeout;          // Seconds an async response may stay pending before a 504, 0 = no limit (see cweb_set_route_timeout)
+    size_t response_cache_size; // Bytes the route response cache may hold across all workers (see cweb_set_route_cache), 0 = off
+    IoBackend io_backend;       // Socket I/O implementation
+    bool http2;                 // Accept HTTP/2 (h2c upgrade, prior knowledge, ALPN h2), needs nghttp2. File bodies are mapped instead of sendfile
+    const char *tls_cert_file;  // PEM certificate chain, with tls_key_file serves HTTPS only (needs OpenSSL)
+    const char *tls_key_file;   // PEM private key for tls_cert_file
+} ServerConfig;
+
 typedef enum {
     FILESYSTEM,  // Serve directly from filesystem
    	MEMORY,      // Serve from in-memory cache
     HYBRID       // Try memory first, fallback to filesystem
 } Mode;
 
+ServerConfig cweb_default_server_config(void);
+void cweb_server_configure(const ServerConfig *config);
 void cweb_run_server(const char *port);
 void cweb_cleanup_server();
+// Index of the worker running on the calling thread (-1 outside of workers)
+int cweb_get_worker_id(void);
 
-// Add a pending response to be checked later
+// Register a response the handler left in PROCESSING state
 void cweb_add_pending_response(Request *req, Response *res, struct bufferevent *bev);
-void cweb_cancel_pending_responses(struct bufferevent *bev);
+// Async handlers call this once the response is filled in: marks it PROCESSED
+// and sends it right away (in request order). Safe to call inside the handler.
+void cweb_response_complete(Response *res);
 void cweb_send_response(struct bufferevent *bev, Request *req, Response *res);
 struct event_base *cweb_get_event_base();
-// Initialize the pending response checking system
-void cweb_init_pending_responses(struct event_base *base);
 
 // Cleanup pending responses
 void cweb_cleanup_pending_responses();
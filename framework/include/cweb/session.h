@@ -9,6 +9,7 @@
 
 #include <time.h>
 #include <pthread.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -29,14 +30,21 @@ typedef struct Session {
     SessionData data[MAX_SESSION_DATA];
     int data_count;
     struct Session *next; // For hash table chaining
+    int refs;             // The store and every request using it, under the store lock
+    bool stored;          // Still in the store, not expired
+    char **retired;       // Replaced values, freed once no request uses the session
+    int retired_count;
 } Session;
 
 // Session store management
 void session_store_init();
 void session_store_destroy();
 
-// Session operations
+// Session operations. Workers share the store: the session returned is
+// referenced until release_session (cweb_free_http_request does it for
+// req->session), and a value stays valid as long as that reference.
 Session* get_or_create_session(const char *session_id);
+void release_session(Session *s);
 const char* get_session_value(Session *s, const char *key);
 void set_session_value(Session *s, const char *key, const char *value);
 
@@ -14,6 +14,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <cweb/logger.h>
+#include <cweb/thread_local.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,8 +27,8 @@ typedef struct {
     size_t capacity;
 } cweb_buffer_t;
 
-// Global output buffer
-extern cweb_buffer_t g_output_buffer;
+// Output buffer of the calling worker thread
+extern CWEB_THREAD_LOCAL cweb_buffer_t g_output_buffer;
 
 void cweb_output_init(void);
 void cweb_output_raw(const char *str);
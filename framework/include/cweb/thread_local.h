@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#ifndef CWEB_THREAD_LOCAL_H
+#define CWEB_THREAD_LOCAL_H
+
+// Storage class for state that is owned by one server worker thread
+// (event base, pending responses, template output buffer, ...).
+#if defined(__cplusplus)
+#define CWEB_THREAD_LOCAL thread_local
+#else
+#define CWEB_THREAD_LOCAL _Thread_local
+#endif
+
+#endif /* CWEB_THREAD_LOCAL_H */
@@ -28,7 +28,7 @@ static void copy_string(char *dest, size_t dest_size, const char *src) {
 void cwagger_init(const char *doc_path) {
     memset(&g_cwagger_doc, 0, sizeof(g_cwagger_doc));
     copy_string(g_cwagger_doc.doc_path, sizeof(g_cwagger_doc.doc_path), doc_path);
-    cweb_add_route(doc_path, cweb_cwaggerdoc_page, false);
+    cweb_add_method_route(CWEB_METHOD_GET, doc_path, cweb_cwaggerdoc_page, false);
 }
 
 int cwagger_add(const char *method, const char *path,
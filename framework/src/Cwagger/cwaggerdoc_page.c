@@ -11,15 +11,7 @@
 #include "cwagger.template.h"
 
 void cweb_cwaggerdoc_page(Request *req, Response *res) {
-
-	if (strcmp(req->method, "GET") != 0) { 
-		res->status_code = 403;
-		res->body = "Method not allowed";
-		res->body_len = strlen(res->body);
-		cweb_add_response_header(res, "Content-Type", "text/plain");
-		return;
-	}
-
+	(void)req;
 
 	cwagger_endpoint *apidoc = cwagger_get_endpoints();
 	size_t count = cwagger_get_endpoint_count();
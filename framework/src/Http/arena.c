@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/arena.h>
+#include <cweb/leak_detector.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct CwebArenaBlock {
+    CwebArenaBlock *next;
+    size_t size;
+    alignas(max_align_t) char data[];
+};
+
+#define ARENA_ALIGN (alignof(max_align_t))
+
+static CwebArenaBlock *arena_block_new(size_t size, CwebArenaBlock *next) {
+    CwebArenaBlock *block = malloc(sizeof(CwebArenaBlock) + size);
+    if (!block) return NULL;
+    block->size = size;
+    block->next = next;
+    cweb_leak_tracker_record("arena.block", block, sizeof(CwebArenaBlock) + size, true);
+    return block;
+}
+
+void *cweb_arena_alloc(CwebArena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (size <= (size_t)(arena->end - arena->cur)) {
+        void *p = arena->cur;
+        arena->cur += size;
+        return p;
+    }
+
+    // Big allocations get a block of their own behind the current one, so
+    // the free space left in it is not thrown away
+    if (size > CWEB_ARENA_BLOCK_SIZE / 4 && arena->blocks) {
+        CwebArenaBlock *block = arena_block_new(size, arena->blocks->next);
+        if (!block) return NULL;
+        arena->blocks->next = block;
+        return block->data;
+    }
+
+    CwebArenaBlock *block = arena_block_new(size > CWEB_ARENA_BLOCK_SIZE ? size : CWEB_ARENA_BLOCK_SIZE, arena->blocks);
+    if (!block) return NULL;
+    arena->blocks = block;
+    arena->cur = block->data + size;
+    arena->end = block->data + block->size;
+    return block->data;
+}
+
+char *cweb_arena_strndup(CwebArena *arena, const char *s, size_t len) {
+    char *copy = cweb_arena_alloc(arena, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char *cweb_arena_strdup(CwebArena *arena, const char *s) {
+    return cweb_arena_strndup(arena, s, strlen(s));
+}
+
+void cweb_arena_release(CwebArena *arena) {
+    CwebArenaBlock *block = arena->blocks;
+    while (block) {
+        CwebArenaBlock *next = block->next;
+        cweb_leak_tracker_record("arena.block", block, sizeof(CwebArenaBlock) + block->size, false);
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->cur = arena->end = NULL;
+}
+
+void cweb_arena_reset(CwebArena *arena) {
+    CwebArenaBlock *keep = NULL;
+    CwebArenaBlock *block = arena->blocks;
+    while (block) {
+        CwebArenaBlock *next = block->next;
+        if (!keep && block->size == CWEB_ARENA_BLOCK_SIZE) {
+            keep = block;
+        } else {
+            cweb_leak_tracker_record("arena.block", block, sizeof(CwebArenaBlock) + block->size, false);
+            free(block);
+        }
+        block = next;
+    }
+    arena->blocks = keep;
+    if (keep) {
+        keep->next = NULL;
+        arena->cur = keep->data;
+        arena->end = keep->data + keep->size;
+    } else {
+        arena->cur = arena->end = NULL;
+    }
+}
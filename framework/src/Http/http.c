@@ -9,173 +9,362 @@
 #include <cweb/autofree.h>
 #include <cweb/logger.h>
 #include <cweb/leak_detector.h>
+#include "http_scan.h"
+#include "http_header.h"
+#include <cweb/thread_local.h>
+#include <cweb/dev.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <event2/buffer.h>
 
+// Spare requests and responses kept per thread
+#define HTTP_POOL_MAX 256
 
+// Free lists, linked through body_ctx / async_data while pooled. Dev mode
+// does not pool, so a use after free stays visible to sanitizers.
+static CWEB_THREAD_LOCAL Request *request_pool = NULL;
+static CWEB_THREAD_LOCAL int request_pool_size = 0;
+static CWEB_THREAD_LOCAL Response *response_pool = NULL;
+static CWEB_THREAD_LOCAL int response_pool_size = 0;
 
+static bool pool_enabled(void) {
+    return cweb_get_mode() != CWEB_MODE_DEV;
+}
+
+// Slot for one more header, moving past the inline slots on demand (into
+// the arena, or the heap for a standalone response). NULL at MAX_HEADERS.
+static Header *header_slot(Header **headers, int count, int *capacity, const Header *inline_headers, CwebArena *arena) {
+    if (count >= MAX_HEADERS) return NULL;
+    if (count == *capacity) {
+        int grown = *capacity * 2 < MAX_HEADERS ? *capacity * 2 : MAX_HEADERS;
+        Header *bigger = arena ? cweb_arena_alloc(arena, grown * sizeof(Header)) : malloc(grown * sizeof(Header));
+        if (!bigger) return NULL;
+        memcpy(bigger, *headers, count * sizeof(Header));
+        if (!arena && *headers != inline_headers) free(*headers);
+        *headers = bigger;
+        *capacity = grown;
+    }
+    return &(*headers)[count];
+}
+
+// Makes the header just stored at position count findable by its id
+static void header_index_add(uint8_t *index, const Header *h, int count) {
+    if (h->id != CWEB_HEADER_UNKNOWN && index[h->id] == 0) index[h->id] = (uint8_t)(count + 1);
+}
+
+// Headers and session_id live in the arena and go with it
 void cweb_free_http_request(Request *req) {
     if (!req) return;
-    for (int i = 0; i < req->header_count; i++) {
-        if (req->headers[i].key) {
-            cweb_leak_tracker_record("req.header.key", req->headers[i].key, strlen(req->headers[i].key) + 1, false);
-            free(req->headers[i].key);
-        }
-        if (req->headers[i].value) {
-            cweb_leak_tracker_record("req.header.value", req->headers[i].value, strlen(req->headers[i].value) + 1, false);
-            free(req->headers[i].value);
-        }
-    }
     if (req->body) {
         cweb_leak_tracker_record("req.body", req->body, 0, false);
         free(req->body);
     }
-    if (req->session_id) {
-        cweb_leak_tracker_record("req.session_id", req->session_id, strlen(req->session_id) + 1, false);
-        free(req->session_id);
-    }
+    release_session(req->session);
     cweb_leak_tracker_record("Request", req, sizeof(*req), false);
+    if (pool_enabled() && request_pool_size < HTTP_POOL_MAX) {
+        cweb_arena_reset(&req->arena); // The first block is reused with the request
+        req->body_ctx = request_pool;
+        request_pool = req;
+        request_pool_size++;
+        return;
+    }
+    cweb_arena_release(&req->arena);
     free(req);
-	LOG_DEBUG("HTTP", "Request freed");
-}
-
-static char* get_cookie_value(Request *req, const char* cookie_name) {
-    for (int i = 0; i < req->header_count; i++) {
-        if (strcasecmp(req->headers[i].key, "Cookie") == 0) {
-            char *cookie_header = strdup(req->headers[i].value);
-            if (cookie_header) cweb_leak_tracker_record("cookie.header.copy", cookie_header, strlen(cookie_header) + 1, true);
-            // TODO: check unused code
-            // AUTOFREE char* cookie_header_to_free = cookie_header;
-
-            char *cookie = strtok(cookie_header, "; ");
-            while (cookie) {
-                char *equals = strchr(cookie, '=');
-                if (equals) {
-                    *equals = '\0';
-                    char *name = cookie;
-                    char *value = equals + 1;
-                    if (strcmp(name, cookie_name) == 0) {
-                        LOG_DEBUG("HTTP", "Cookie found: %s=%s", name, value);
-                        char *dup = strdup(value);
-                        if (dup) cweb_leak_tracker_record("cookie.value", dup, strlen(dup) + 1, true);
-                        cweb_leak_tracker_record("cookie.header.copy", cookie_header, strlen(cookie_header) + 1, false);
-                        free(cookie_header);
-                        return dup;
-                    }
+}
+
+void *cweb_request_alloc(Request *req, size_t size) {
+    return cweb_arena_alloc(&req->arena, size);
+}
+
+char *cweb_request_strdup(Request *req, const char *s) {
+    return cweb_arena_strdup(&req->arena, s);
+}
+
+// Cookie headers are only read here, when a route or handler asks: each
+// lookup walks the name=value pairs in place, nothing is copied or stored
+bool cweb_get_cookie(const Request *req, const char *name, const char **value, size_t *value_len) {
+    if (!req || !name || !req->header_index[CWEB_HEADER_COOKIE]) return false;
+    size_t name_len = strlen(name);
+    // HTTP/2 joins its cookie fields, HTTP/1 clients should send one header
+    for (int i = req->header_index[CWEB_HEADER_COOKIE] - 1; i < req->header_count; i++) {
+        if (req->headers[i].id != CWEB_HEADER_COOKIE) continue;
+        const char *p = req->headers[i].value;
+        while (*p) {
+            while (*p == ' ' || *p == '\t' || *p == ';') p++;
+            const char *end = strchrnul(p, ';');
+            const char *eq = memchr(p, '=', (size_t)(end - p));
+            if (eq && (size_t)(eq - p) == name_len && memcmp(p, name, name_len) == 0) {
+                const char *v = eq + 1;
+                const char *v_end = end;
+                while (v_end > v && (v_end[-1] == ' ' || v_end[-1] == '\t')) v_end--;
+                if (v_end - v >= 2 && *v == '"' && v_end[-1] == '"') {
+                    v++;
+                    v_end--;
                 }
-                cookie = strtok(NULL, "; ");
+                *value = v;
+                *value_len = (size_t)(v_end - v);
+                return true;
             }
-            LOG_DEBUG("HTTP", "Cookie not found: %s", cookie_name);
-            cweb_leak_tracker_record("cookie.header.copy", cookie_header, strlen(cookie_header) + 1, false);
-            free(cookie_header);
-            return NULL;
+            p = end;
         }
     }
-	LOG_DEBUG("HTTP", "No Cookie header found");
-    return NULL;
+    return false;
 }
 
-Request* cweb_parse_request(const char *raw_request, size_t len) {
-    Request *req = calloc(1, sizeof(Request));
-    if (!req) return NULL;
-    cweb_leak_tracker_record("Request", req, sizeof(*req), true);
+static inline bool http_at_crlf(const char *p, const char *end) {
+    return end - p >= 2 && p[0] == '\r' && p[1] == '\n';
+}
 
-    char *buffer = strndup(raw_request, len);
-    if (buffer) cweb_leak_tracker_record("request.buffer", buffer, len + 1, true);
+// Single pass over the head (RFC 9112 section 2 to 5). Nothing is copied:
+// the terminating NULs overwrite the SP after the target, the colon after
+// a name and the CR or whitespace after a value. The final CRLF stops every
+// scan, the long ones go through the SIMD kernels of http_scan.c.
+int cweb_parse_request_head(Request *req, char *head, size_t len) {
+    if (len < 4 || memcmp(head + len - 4, "\r\n\r\n", 4) != 0) return 400;
+    char *p = head;
+    char *end = head + len;
 
-	// TODO: check unused code
-    // AUTOFREE char *buffer_to_free = buffer;
+    // Servers should ignore empty lines before the request line
+    while (http_at_crlf(p, end)) p += 2;
 
-    char *saveptr;
-    char *line = strtok_r(buffer, "\r\n", &saveptr);
-    if (!line) { 
+    // method SP request-target SP HTTP-version CRLF
+    char *method = p;
+    p = http_scan->scan_token(p, end);
+    if (p == method || *p != ' ') return 400;
+    size_t method_len = (size_t)(p - method);
+    if (method_len >= sizeof(req->method)) return 501;
 
-        if (buffer) { cweb_leak_tracker_record("request.buffer", buffer, len + 1, false);
-            free(buffer); 
-        }
-        cweb_free_http_request(req); 
-        return NULL; 
-    }
-
-    // Parse request line
-    sscanf(line, "%15s %2047s %15s", req->method, req->path, req->version);
-
-    // Parse headers
-    while ((line = strtok_r(NULL, "\r\n", &saveptr))) {
-        if (strlen(line) == 0) break; // End of headers
-
-        char *colon = strchr(line, ':');
-        if (colon && req->header_count < MAX_HEADERS) {
-            *colon = '\0';
-            char *key = line;
-            char *value = colon + 1;
-            while (isspace(*value)) value++; // Trim leading space
-
-            req->headers[req->header_count].key = strdup(key);
-            if (req->headers[req->header_count].key)
-                cweb_leak_tracker_record("req.header.key", req->headers[req->header_count].key, strlen(req->headers[req->header_count].key) + 1, true);
-            req->headers[req->header_count].value = strdup(value);
-            if (req->headers[req->header_count].value)
-                cweb_leak_tracker_record("req.header.value", req->headers[req->header_count].value, strlen(req->headers[req->header_count].value) + 1, true);
-            req->header_count++;
-        }
+    char *target = ++p;
+    p = http_scan->scan_target(p, end);
+    if (p == target || *p != ' ') return 400;
+    size_t target_len = (size_t)(p - target);
+    if (target_len >= MAX_PATH_LEN) return 414;
+
+    char *version = ++p;
+    if (end - p < 10 || memcmp(p, "HTTP/", 5) != 0 || !isdigit((unsigned char)p[5]) ||
+        p[6] != '.' || !isdigit((unsigned char)p[7]) || !http_at_crlf(p + 8, end)) {
+        return 400;
     }
-    
-    req->session_id = get_cookie_value(req, "session_id");
-	LOG_DEBUG("HTTP", "Extracted session_id from cookie: %s", req->session_id ? req->session_id : "NULL");
+    if (p[5] != '1') return 505;
+    p += 10;
+
+    memcpy(req->method, method, method_len);
+    req->method[method_len] = '\0';
+    req->method_id = cweb_http_method(method, method_len);
+    memcpy(req->version, version, 8);
+    req->version[8] = '\0';
+    target[target_len] = '\0';
+    req->path = target;
+    req->path_len = target_len;
+
+    // field-name ":" OWS field-value OWS CRLF, up to the empty line
+    int hosts = 0;
+    while (!http_at_crlf(p, end)) {
+        // Also rejects whitespace before the colon and obs-fold lines
+        char *name = p;
+        p = http_scan->scan_token(p, end);
+        if (p == name || *p != ':') return 400;
+        char *name_end = p++;
+
+        while (*p == ' ' || *p == '\t') p++;
+        char *value = p;
+        p = http_scan->scan_field(p, end);
+        if (!http_at_crlf(p, end)) return 400;
+        char *value_end = p;
+        while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+        p += 2;
+
+        if (req->header_count >= MAX_HEADERS) return 431;
+        Header *h = header_slot(&req->headers, req->header_count, &req->header_capacity, req->inline_headers, &req->arena);
+        if (!h) return 500;
+        h->id = http_header_classify(name, (size_t)(name_end - name), &h->hash);
+        *name_end = '\0';
+        *value_end = '\0';
+        h->key = name;
+        h->value = value;
+        h->key_len = (uint32_t)(name_end - name);
+        h->value_len = (uint32_t)(value_end - value);
+        header_index_add(req->header_index, h, req->header_count);
+        req->header_count++;
+        if (h->id == CWEB_HEADER_HOST) hosts++;
+    }
+    if (p + 2 != end) return 400;
+
+    // Exactly one Host, and HTTP/1.0 clients may leave it out (RFC 9112 3.2)
+    if (hosts > 1 || (hosts == 0 && strcmp(req->version, "HTTP/1.0") != 0)) return 400;
+
+	LOG_DEBUG("HTTP", "Parsed %s %s %s with %d headers", req->method, req->path, req->version, req->header_count);
+    return 0;
+}
 
-	LOG_DEBUG("Parse request end", "Request method: %s, path: %s, version: %s", req->method, req->path, req->version);
+// Copies the head into the request arena and parses it there
+Request* cweb_parse_request(const char *raw_request, size_t len) {
+    Request *req = cweb_create_request();
+    if (!req) return NULL;
+    char *head = cweb_arena_alloc(&req->arena, len);
+    if (head) memcpy(head, raw_request, len);
+    if (!head || cweb_parse_request_head(req, head, len) != 0) {
+        cweb_free_http_request(req);
+        return NULL;
+    }
+    return req;
+}
 
-    if (buffer) { cweb_leak_tracker_record("request.buffer", buffer, len + 1, false);
-        free(buffer);
+// Empty request for transports that do not read an HTTP/1 head (HTTP/2)
+Request* cweb_create_request(void) {
+    Request *req = request_pool;
+    if (req) {
+        request_pool = req->body_ctx;
+        request_pool_size--;
+    } else {
+        req = malloc(sizeof(Request));
+        if (!req) return NULL;
+        req->arena = (CwebArena){0};
     }
+    // The inline header slots are written before they are read
+    CwebArena arena = req->arena;
+    memset(req, 0, offsetof(Request, inline_headers));
+    req->arena = arena;
+    req->path = "";
+    req->headers = req->inline_headers;
+    req->header_capacity = INLINE_HEADERS;
+    cweb_leak_tracker_record("Request", req, sizeof(*req), true);
     return req;
 }
 
+void cweb_add_request_header(Request *req, const char *key, const char *value) {
+    Header *h = header_slot(&req->headers, req->header_count, &req->header_capacity, req->inline_headers, &req->arena);
+    if (!h) return;
+    h->key_len = (uint32_t)strlen(key);
+    h->value_len = (uint32_t)strlen(value);
+    h->key = cweb_arena_strndup(&req->arena, key, h->key_len);
+    h->value = cweb_arena_strndup(&req->arena, value, h->value_len);
+    if (!h->key || !h->value) return;
+    h->id = http_header_classify(key, h->key_len, &h->hash);
+    header_index_add(req->header_index, h, req->header_count);
+    req->header_count++;
+}
+
 Response* cweb_create_response() {
-    Response *res = calloc(1, sizeof(Response));
+    Response *res = response_pool;
     if (res) {
-        cweb_leak_tracker_record("Response", res, sizeof(*res), true);
-        res->priority = 0; // Default priority
+        response_pool = res->async_data;
+        response_pool_size--;
+    } else {
+        res = malloc(sizeof(Response));
+        if (!res) return NULL;
     }
+    memset(res, 0, offsetof(Response, inline_headers));
+    res->priority = 0; // Default priority
+    res->headers = res->inline_headers;
+    res->header_capacity = INLINE_HEADERS;
+    cweb_leak_tracker_record("Response", res, sizeof(*res), true);
+    return res;
+}
+
+Response* cweb_create_response_for(Request *req) {
+    Response *res = cweb_create_response();
+    if (res && req) res->arena = &req->arena;
     return res;
 }
 
 void cweb_free_http_response(Response *res) {
 	LOG_DEBUG("HTTP", "Freeing response");
     if (!res) return;
-    for (int i = 0; i < res->header_count; i++) {
-        if (res->headers[i].key) {
-            cweb_leak_tracker_record("res.header.key", res->headers[i].key, strlen(res->headers[i].key) + 1, false);
+    for (int i = 0; i < res->header_count && !res->arena; i++) {
+        if (res->headers[i].key && res->headers[i].id == CWEB_HEADER_UNKNOWN) {
+            cweb_leak_tracker_record("res.header.key", res->headers[i].key, res->headers[i].key_len + 1, false);
             free(res->headers[i].key);
         }
         if (res->headers[i].value) {
-            cweb_leak_tracker_record("res.header.value", res->headers[i].value, strlen(res->headers[i].value) + 1, false);
+            cweb_leak_tracker_record("res.header.value", res->headers[i].value, res->headers[i].value_len + 1, false);
             free(res->headers[i].value);
         }
     }
+    if (!res->arena && res->headers != res->inline_headers) {
+        free(res->headers);
+    }
     if (res->body && res->isliteral != 1) {
         cweb_leak_tracker_record("res.body", res->body, res->body_len, false);
        
         free(res->body);
     }
+    if (res->body_file) {
+        cweb_leak_tracker_record("res.body_file", res->body_file, res->body_len, false);
+        evbuffer_free(res->body_file);
+    }
+    cweb_shared_body_release(res->shared);
     cweb_leak_tracker_record("Response", res, sizeof(*res), false);
+    if (pool_enabled() && response_pool_size < HTTP_POOL_MAX) {
+        res->async_data = response_pool;
+        response_pool = res;
+        response_pool_size++;
+        return;
+    }
     free(res);
 }
 
+void cweb_http_pool_cleanup(void) {
+    while (request_pool) {
+        Request *req = request_pool;
+        request_pool = req->body_ctx;
+        cweb_arena_release(&req->arena);
+        free(req);
+    }
+    request_pool_size = 0;
+    while (response_pool) {
+        Response *res = response_pool;
+        response_pool = res->async_data;
+        free(res);
+    }
+    response_pool_size = 0;
+}
+
 void cweb_add_response_header(Response *res, const char *key, const char *value) {
 	LOG_DEBUG("HTTP", "Adding response header: %s: %s", key, value);
-    if (res->header_count < MAX_HEADERS) {
-        res->headers[res->header_count].key = strdup(key);
-        if (res->headers[res->header_count].key)
-            cweb_leak_tracker_record("res.header.key", res->headers[res->header_count].key, strlen(res->headers[res->header_count].key) + 1, true);
-        res->headers[res->header_count].value = strdup(value);
-        if (res->headers[res->header_count].value)
-            cweb_leak_tracker_record("res.header.value", res->headers[res->header_count].value, strlen(res->headers[res->header_count].value) + 1, true);
-        res->header_count++;
+    Header *h = header_slot(&res->headers, res->header_count, &res->header_capacity, res->inline_headers, res->arena);
+    if (!h) return;
+    // Known names are interned, only custom ones are copied
+    h->key_len = (uint32_t)strlen(key);
+    h->value_len = (uint32_t)strlen(value);
+    h->id = http_header_classify(key, h->key_len, &h->hash);
+    if (res->arena) {
+        h->key = h->id ? (char *)cweb_header_name(h->id) : cweb_arena_strndup(res->arena, key, h->key_len);
+        h->value = cweb_arena_strndup(res->arena, value, h->value_len);
+        if (!h->key || !h->value) return;
+    } else {
+        if (h->id) {
+            h->key = (char *)cweb_header_name(h->id);
+        } else {
+            h->key = strndup(key, h->key_len);
+            if (h->key)
+                cweb_leak_tracker_record("res.header.key", h->key, h->key_len + 1, true);
+        }
+        h->value = strndup(value, h->value_len);
+        if (h->value)
+            cweb_leak_tracker_record("res.header.value", h->value, h->value_len + 1, true);
     }
+    header_index_add(res->header_index, h, res->header_count);
+    res->header_count++;
+}
+
+// Known names go through the index, custom ones compare hashes first
+static const char *header_find(const Header *headers, int count, const uint8_t *index, const char *key) {
+    uint32_t hash;
+    HeaderId id = http_header_classify(key, strlen(key), &hash);
+    if (id != CWEB_HEADER_UNKNOWN) {
+        return index[id] ? headers[index[id] - 1].value : NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        if (headers[i].hash == hash && headers[i].key && strcasecmp(headers[i].key, key) == 0) {
+            return headers[i].value; // Direktpointer, nicht freigeben
+        }
+    }
+    return NULL;
 }
 
 const char* cweb_get_response_header(const Response *res, const char *key) {
@@ -183,12 +372,131 @@ const char* cweb_get_response_header(const Response *res, const char *key) {
 		LOG_DEBUG("HTTP", "get_response_header invalid args");
 		return NULL;
 	}
-	for (int i = 0; i < res->header_count; i++) {
-		if (res->headers[i].key && strcasecmp(res->headers[i].key, key) == 0) {
-			return res->headers[i].value; // Direktpointer, nicht freigeben
-		}
+	const char *value = header_find(res->headers, res->header_count, res->header_index, key);
+	if (!value && res->header_block) {
+		const CwebHeaderBlock *block = res->header_block;
+		value = header_find(block->headers, block->header_count, block->header_index, key);
 	}
-	return NULL;
+	return value;
+}
+
+const char* cweb_get_response_header_id(const Response *res, HeaderId id) {
+    if (!res || (unsigned)id >= CWEB_HEADER_COUNT || id == CWEB_HEADER_UNKNOWN) return NULL;
+    if (res->header_index[id]) return res->headers[res->header_index[id] - 1].value;
+    const CwebHeaderBlock *block = res->header_block;
+    return block && block->header_index[id] ? block->headers[block->header_index[id] - 1].value : NULL;
+}
+
+// Written per response, never part of a block
+static bool header_block_excluded(const Header *h) {
+    return h->id == CWEB_HEADER_CONTENT_LENGTH || h->id == CWEB_HEADER_DATE || !h->value;
+}
+
+// One allocation: the block, its headers, the NUL-terminated names and
+// values they point to, and the serialized lines
+CwebHeaderBlock* cweb_header_block_new(const Response *res) {
+    if (!res) return NULL;
+    int count = 0;
+    size_t strings = 0, data = 0;
+    for (int i = 0; i < res->header_count; i++) {
+        const Header *h = &res->headers[i];
+        if (header_block_excluded(h)) continue;
+        count++;
+        strings += h->value_len + 1 + (h->id ? 0 : h->key_len + 1);
+        data += h->key_len + h->value_len + 4; // ": \r\n"
+    }
+
+    size_t size = sizeof(CwebHeaderBlock) + (size_t)count * sizeof(Header) + strings + data;
+    CwebHeaderBlock *block = calloc(1, size);
+    if (!block) return NULL;
+    cweb_leak_tracker_record("header_block", block, size, true);
+    block->headers = (Header *)(block + 1);
+    char *s = (char *)(block->headers + count);
+    block->data = s + strings;
+
+    char *p = block->data;
+    for (int i = 0; i < res->header_count; i++) {
+        const Header *src = &res->headers[i];
+        if (header_block_excluded(src)) continue;
+        Header *h = &block->headers[block->header_count];
+        *h = *src;
+        if (h->id) {
+            h->key = (char *)http_header_names_lower[h->id];
+        } else {
+            h->key = s;
+            for (uint32_t j = 0; j < src->key_len; j++) s[j] = (char)tolower((unsigned char)src->key[j]);
+            s += src->key_len + 1;
+        }
+        h->value = memcpy(s, src->value, src->value_len);
+        s += src->value_len + 1;
+        header_index_add(block->header_index, h, block->header_count);
+        block->header_count++;
+
+        memcpy(p, src->key, src->key_len);
+        p += src->key_len;
+        memcpy(p, ": ", 2);
+        p += 2;
+        memcpy(p, src->value, src->value_len);
+        p += src->value_len;
+        memcpy(p, "\r\n", 2);
+        p += 2;
+    }
+    block->len = (size_t)(p - block->data);
+    return block;
+}
+
+void cweb_header_block_free(CwebHeaderBlock *block) {
+    if (!block) return;
+    cweb_leak_tracker_record("header_block", block, 0, false);
+    free(block);
+}
+
+// The body follows the struct in the same allocation
+CwebSharedBody* cweb_shared_body_new(const Response *res) {
+    if (!res) return NULL;
+    size_t body_len = res->body ? res->body_len : 0;
+    CwebSharedBody *shared = malloc(sizeof(*shared) + body_len);
+    if (!shared) return NULL;
+    shared->headers = cweb_header_block_new(res);
+    if (!shared->headers) {
+        free(shared);
+        return NULL;
+    }
+    cweb_leak_tracker_record("shared_body", shared, sizeof(*shared) + body_len, true);
+    shared->refs = 1;
+    shared->status_code = res->status_code;
+    shared->body = (char *)(shared + 1);
+    shared->body_len = body_len;
+    if (body_len) memcpy(shared->body, res->body, body_len);
+    return shared;
+}
+
+void cweb_shared_body_retain(CwebSharedBody *shared) {
+    __atomic_fetch_add(&shared->refs, 1, __ATOMIC_RELAXED);
+}
+
+void cweb_shared_body_release(CwebSharedBody *shared) {
+    if (!shared || __atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    cweb_header_block_free(shared->headers);
+    cweb_leak_tracker_record("shared_body", shared, 0, false);
+    free(shared);
+}
+
+void cweb_response_share(Response *res, CwebSharedBody *shared) {
+    if (!res || !shared) return;
+    cweb_shared_body_retain(shared);
+    cweb_shared_body_release(res->shared);
+    res->shared = shared;
+    res->status_code = shared->status_code;
+    res->header_block = shared->headers;
+    if (res->body && !res->isliteral) {
+        cweb_leak_tracker_record("res.body", res->body, res->body_len, false);
+        free(res->body);
+    }
+    res->body = shared->body;
+    res->body_len = shared->body_len;
+    res->isliteral = 1;
+    res->state = PROCESSED;
 }
 
 void cweb_add_performance_headers(Response *res, const char *content_type) {
@@ -212,49 +520,246 @@ void cweb_add_performance_headers(Response *res, const char *content_type) {
     
 }
 
+typedef struct {
+    const char *line;   // Complete status line including CRLF
+    const char *reason;
+    uint8_t line_len;
+} StatusLine;
+
+#define STATUS(code, reason) \
+    [code - 100] = { "HTTP/1.1 " #code " " reason "\r\n", reason, sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1 }
+
+// Every code registered with IANA, serialized at compile time
+static const StatusLine status_lines[500] = {
+    STATUS(100, "Continue"),
+    STATUS(101, "Switching Protocols"),
+    STATUS(102, "Processing"),
+    STATUS(103, "Early Hints"),
+    STATUS(200, "OK"),
+    STATUS(201, "Created"),
+    STATUS(202, "Accepted"),
+    STATUS(203, "Non-Authoritative Information"),
+    STATUS(204, "No Content"),
+    STATUS(205, "Reset Content"),
+    STATUS(206, "Partial Content"),
+    STATUS(207, "Multi-Status"),
+    STATUS(208, "Already Reported"),
+    STATUS(226, "IM Used"),
+    STATUS(300, "Multiple Choices"),
+    STATUS(301, "Moved Permanently"),
+    STATUS(302, "Found"),
+    STATUS(303, "See Other"),
+    STATUS(304, "Not Modified"),
+    STATUS(305, "Use Proxy"),
+    STATUS(307, "Temporary Redirect"),
+    STATUS(308, "Permanent Redirect"),
+    STATUS(400, "Bad Request"),
+    STATUS(401, "Unauthorized"),
+    STATUS(402, "Payment Required"),
+    STATUS(403, "Forbidden"),
+    STATUS(404, "Not Found"),
+    STATUS(405, "Method Not Allowed"),
+    STATUS(406, "Not Acceptable"),
+    STATUS(407, "Proxy Authentication Required"),
+    STATUS(408, "Request Timeout"),
+    STATUS(409, "Conflict"),
+    STATUS(410, "Gone"),
+    STATUS(411, "Length Required"),
+    STATUS(412, "Precondition Failed"),
+    STATUS(413, "Content Too Large"),
+    STATUS(414, "URI Too Long"),
+    STATUS(415, "Unsupported Media Type"),
+    STATUS(416, "Range Not Satisfiable"),
+    STATUS(417, "Expectation Failed"),
+    STATUS(421, "Misdirected Request"),
+    STATUS(422, "Unprocessable Content"),
+    STATUS(423, "Locked"),
+    STATUS(424, "Failed Dependency"),
+    STATUS(425, "Too Early"),
+    STATUS(426, "Upgrade Required"),
+    STATUS(428, "Precondition Required"),
+    STATUS(429, "Too Many Requests"),
+    STATUS(431, "Request Header Fields Too Large"),
+    STATUS(451, "Unavailable For Legal Reasons"),
+    STATUS(500, "Internal Server Error"),
+    STATUS(501, "Not Implemented"),
+    STATUS(502, "Bad Gateway"),
+    STATUS(503, "Service Unavailable"),
+    STATUS(504, "Gateway Timeout"),
+    STATUS(505, "HTTP Version Not Supported"),
+    STATUS(506, "Variant Also Negotiates"),
+    STATUS(507, "Insufficient Storage"),
+    STATUS(508, "Loop Detected"),
+    STATUS(510, "Not Extended"),
+    STATUS(511, "Network Authentication Required"),
+};
+
+#undef STATUS
+
+static const StatusLine *status_line(int code) {
+    if (code < 100 || code > 599 || !status_lines[code - 100].line) return NULL;
+    return &status_lines[code - 100];
+}
+
 const char* cweb_get_status_message(int code) {
-    switch (code) {
-        case 200: return "OK";
-        case 404: return "Not Found";
-        case 500: return "Internal Server Error";
-        default: return "Unknown";
+    const StatusLine *s = status_line(code);
+    return s ? s->reason : "Unknown";
+}
+
+static const char *const method_names[CWEB_METHOD_COUNT] = {
+    [CWEB_METHOD_UNKNOWN] = "",
+    [CWEB_METHOD_GET] = "GET",
+    [CWEB_METHOD_HEAD] = "HEAD",
+    [CWEB_METHOD_POST] = "POST",
+    [CWEB_METHOD_PUT] = "PUT",
+    [CWEB_METHOD_DELETE] = "DELETE",
+    [CWEB_METHOD_CONNECT] = "CONNECT",
+    [CWEB_METHOD_OPTIONS] = "OPTIONS",
+    [CWEB_METHOD_TRACE] = "TRACE",
+    [CWEB_METHOD_PATCH] = "PATCH",
+};
+
+HttpMethod cweb_http_method(const char *name, size_t len) {
+    // The length and first byte leave at most one candidate
+    HttpMethod candidate = CWEB_METHOD_UNKNOWN;
+    switch (len) {
+    case 3: candidate = name[0] == 'G' ? CWEB_METHOD_GET : CWEB_METHOD_PUT; break;
+    case 4: candidate = name[0] == 'H' ? CWEB_METHOD_HEAD : CWEB_METHOD_POST; break;
+    case 5: candidate = name[0] == 'P' ? CWEB_METHOD_PATCH : CWEB_METHOD_TRACE; break;
+    case 6: candidate = CWEB_METHOD_DELETE; break;
+    case 7: candidate = name[0] == 'O' ? CWEB_METHOD_OPTIONS : CWEB_METHOD_CONNECT; break;
+    default: return CWEB_METHOD_UNKNOWN;
     }
+    return memcmp(name, method_names[candidate], len) == 0 ? candidate : CWEB_METHOD_UNKNOWN;
 }
 
-char* cweb_serialize_response(Response *res, size_t *total_len) {
-    AUTOFREE char *header_buf = NULL;
-    size_t header_len = 0;
-    
-    // Initial status line
-    char status_line[128];
-    int status_len = snprintf(status_line, sizeof(status_line), "HTTP/1.1 %d %s\r\n", res->status_code, cweb_get_status_message(res->status_code));
-    header_len += status_len;
+const char* cweb_http_method_name(HttpMethod method) {
+    return method >= 0 && method < CWEB_METHOD_COUNT ? method_names[method] : "";
+}
+
+typedef struct {
+    time_t second;
+    char value[80]; // 29 used, the rest lets the compiler see any int fields fit
+} DateCache;
 
-    // Content-Length is required
-    char content_length_value[32];
-    snprintf(content_length_value, sizeof(content_length_value), "%zu", res->body_len);
-    cweb_add_response_header(res, "Content-Length", strdup(content_length_value));
+static CWEB_THREAD_LOCAL DateCache date_cache = { -1, "" };
+
+const char* cweb_http_date(void) {
+    static const char days[7][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char months[12][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    time_t now = time(NULL);
+    if (now != date_cache.second) {
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        snprintf(date_cache.value, sizeof(date_cache.value), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                 days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        date_cache.second = now;
+    }
+    return date_cache.value;
+}
+
+#define HTTP_DATE_LEN 29 // "Sun, 06 Nov 1994 08:49:37 GMT"
+
+// Informational, 204 and 304 responses carry no Content-Length here: the
+// first two never may (RFC 9110 8.6), a 304 would describe the cached body
+static bool response_has_content_length(const Response *res) {
+    return res->status_code >= 200 && res->status_code != 204 && res->status_code != 304;
+}
+
+// Content-Length always follows body_len, whatever the handler set
+static bool response_header_skipped(const Header *h) {
+    return h->id == CWEB_HEADER_CONTENT_LENGTH || !h->value;
+}
+
+// Decimal digits of v, a lot cheaper than snprintf for the one number in every head
+static size_t format_size(char out[20], size_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (size_t i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+size_t cweb_response_head_length(const Response *res) {
+    const StatusLine *s = status_line(res->status_code);
+    size_t len = s ? s->line_len : (size_t)snprintf(NULL, 0, "HTTP/1.1 %d Unknown\r\n", res->status_code);
+    if (res->header_block) len += res->header_block->len;
 
-    // Add other headers
     for (int i = 0; i < res->header_count; i++) {
-        header_len += strlen(res->headers[i].key) + strlen(res->headers[i].value) + 4; // ": \r\n"
+        const Header *h = &res->headers[i];
+        if (!response_header_skipped(h)) len += h->key_len + h->value_len + 4; // ": \r\n"
     }
-    header_len += 2; // Final "\r\n"
+    if (!res->header_index[CWEB_HEADER_DATE]) len += sizeof("Date: \r\n") - 1 + HTTP_DATE_LEN;
+    if (response_has_content_length(res)) {
+        char digits[20];
+        len += sizeof("Content-Length: \r\n") - 1 + format_size(digits, res->body_len);
+    }
+    return len + 2; // Final "\r\n"
+}
 
-    header_buf = malloc(header_len + 1);
-    strcpy(header_buf, status_line);
+static char *append(char *p, const char *s, size_t len) {
+    memcpy(p, s, len);
+    return p + len;
+}
+
+#define APPEND_LITERAL(p, s) append(p, s, sizeof(s) - 1)
+
+size_t cweb_write_response_head(const Response *res, char *out) {
+    char *p = out;
+    const StatusLine *s = status_line(res->status_code);
+    if (s) {
+        p = append(p, s->line, s->line_len);
+    } else {
+        char line[48];
+        int n = snprintf(line, sizeof(line), "HTTP/1.1 %d Unknown\r\n", res->status_code);
+        p = append(p, line, (size_t)n);
+    }
+    if (res->header_block) p = append(p, res->header_block->data, res->header_block->len);
 
     for (int i = 0; i < res->header_count; i++) {
-        strcat(header_buf, res->headers[i].key);
-        strcat(header_buf, ": ");
-        strcat(header_buf, res->headers[i].value);
-        strcat(header_buf, "\r\n");
+        const Header *h = &res->headers[i];
+        if (response_header_skipped(h)) continue;
+        p = append(p, h->key, h->key_len);
+        p = APPEND_LITERAL(p, ": ");
+        p = append(p, h->value, h->value_len);
+        p = APPEND_LITERAL(p, "\r\n");
+    }
+    if (!res->header_index[CWEB_HEADER_DATE]) {
+        p = APPEND_LITERAL(p, "Date: ");
+        p = append(p, cweb_http_date(), HTTP_DATE_LEN);
+        p = APPEND_LITERAL(p, "\r\n");
     }
-    strcat(header_buf, "\r\n");
-    header_len = strlen(header_buf);
+    if (response_has_content_length(res)) {
+        char digits[20];
+        size_t n = format_size(digits, res->body_len);
+        p = APPEND_LITERAL(p, "Content-Length: ");
+        p = append(p, digits, n);
+        p = APPEND_LITERAL(p, "\r\n");
+    }
+    p = APPEND_LITERAL(p, "\r\n");
+    return (size_t)(p - out);
+}
+
+// Status line and headers only, the body is sent separately (see cweb_send_response)
+char* cweb_serialize_response_head(Response *res, size_t *head_len) {
+    char *head = malloc(cweb_response_head_length(res));
+    if (!head) return NULL;
+    *head_len = cweb_write_response_head(res, head);
+    return head;
+}
+
+char* cweb_serialize_response(Response *res, size_t *total_len) {
+    size_t header_len = 0;
+    AUTOFREE char *header_buf = cweb_serialize_response_head(res, &header_len);
+    if (!header_buf) return NULL;
 
     *total_len = header_len + res->body_len;
     char *full_response = malloc(*total_len);
+    if (!full_response) return NULL;
     memcpy(full_response, header_buf, header_len);
     if (res->body && res->body_len > 0) {
         memcpy(full_response + header_len, res->body, res->body_len);
@@ -269,10 +774,10 @@ const char* cweb_get_request_header(const Request *req, const char *key) {
         LOG_DEBUG("HTTP", "get_request_header invalid args");
         return NULL;
     }
-    for (int i = 0; i < req->header_count; i++) {
-        if (req->headers[i].key && strcasecmp(req->headers[i].key, key) == 0) {
-            return req->headers[i].value; // Direktpointer, nicht freigeben
-        }
-    }
-    return NULL;
+    return header_find(req->headers, req->header_count, req->header_index, key);
+}
+
+const char* cweb_get_request_header_id(const Request *req, HeaderId id) {
+    if (!req || (unsigned)id >= CWEB_HEADER_COUNT || id == CWEB_HEADER_UNKNOWN) return NULL;
+    return req->header_index[id] ? req->headers[req->header_index[id] - 1].value : NULL;
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include "http_header.h"
+#include <string.h>
+
+// Known header names. The parser hashes every name once, a hit in
+// header_table gives the id after one case-insensitive compare. The canonical names are
+// also the interned keys of response headers.
+
+static const char *const header_names[CWEB_HEADER_COUNT] = {
+    [CWEB_HEADER_UNKNOWN] = "",
+    [CWEB_HEADER_ACCEPT] = "Accept",
+    [CWEB_HEADER_ACCEPT_ENCODING] = "Accept-Encoding",
+    [CWEB_HEADER_ACCEPT_LANGUAGE] = "Accept-Language",
+    [CWEB_HEADER_AUTHORIZATION] = "Authorization",
+    [CWEB_HEADER_CACHE_CONTROL] = "Cache-Control",
+    [CWEB_HEADER_CONNECTION] = "Connection",
+    [CWEB_HEADER_CONTENT_ENCODING] = "Content-Encoding",
+    [CWEB_HEADER_CONTENT_LENGTH] = "Content-Length",
+    [CWEB_HEADER_CONTENT_TYPE] = "Content-Type",
+    [CWEB_HEADER_COOKIE] = "Cookie",
+    [CWEB_HEADER_DATE] = "Date",
+    [CWEB_HEADER_ETAG] = "ETag",
+    [CWEB_HEADER_EXPECT] = "Expect",
+    [CWEB_HEADER_EXPIRES] = "Expires",
+    [CWEB_HEADER_HOST] = "Host",
+    [CWEB_HEADER_HTTP2_SETTINGS] = "HTTP2-Settings",
+    [CWEB_HEADER_IF_MODIFIED_SINCE] = "If-Modified-Since",
+    [CWEB_HEADER_IF_NONE_MATCH] = "If-None-Match",
+    [CWEB_HEADER_KEEP_ALIVE] = "Keep-Alive",
+    [CWEB_HEADER_LAST_MODIFIED] = "Last-Modified",
+    [CWEB_HEADER_LINK] = "Link",
+    [CWEB_HEADER_LOCATION] = "Location",
+    [CWEB_HEADER_ORIGIN] = "Origin",
+    [CWEB_HEADER_PROXY_CONNECTION] = "Proxy-Connection",
+    [CWEB_HEADER_RANGE] = "Range",
+    [CWEB_HEADER_REFERER] = "Referer",
+    [CWEB_HEADER_SERVER] = "Server",
+    [CWEB_HEADER_SET_COOKIE] = "Set-Cookie",
+    [CWEB_HEADER_TRANSFER_ENCODING] = "Transfer-Encoding",
+    [CWEB_HEADER_UPGRADE] = "Upgrade",
+    [CWEB_HEADER_USER_AGENT] = "User-Agent",
+    [CWEB_HEADER_VARY] = "Vary",
+    [CWEB_HEADER_X_CONTENT_TYPE_OPTIONS] = "X-Content-Type-Options",
+};
+
+const char *const http_header_names_lower[CWEB_HEADER_COUNT] = {
+    [CWEB_HEADER_UNKNOWN] = "",
+    [CWEB_HEADER_ACCEPT] = "accept",
+    [CWEB_HEADER_ACCEPT_ENCODING] = "accept-encoding",
+    [CWEB_HEADER_ACCEPT_LANGUAGE] = "accept-language",
+    [CWEB_HEADER_AUTHORIZATION] = "authorization",
+    [CWEB_HEADER_CACHE_CONTROL] = "cache-control",
+    [CWEB_HEADER_CONNECTION] = "connection",
+    [CWEB_HEADER_CONTENT_ENCODING] = "content-encoding",
+    [CWEB_HEADER_CONTENT_LENGTH] = "content-length",
+    [CWEB_HEADER_CONTENT_TYPE] = "content-type",
+    [CWEB_HEADER_COOKIE] = "cookie",
+    [CWEB_HEADER_DATE] = "date",
+    [CWEB_HEADER_ETAG] = "etag",
+    [CWEB_HEADER_EXPECT] = "expect",
+    [CWEB_HEADER_EXPIRES] = "expires",
+    [CWEB_HEADER_HOST] = "host",
+    [CWEB_HEADER_HTTP2_SETTINGS] = "http2-settings",
+    [CWEB_HEADER_IF_MODIFIED_SINCE] = "if-modified-since",
+    [CWEB_HEADER_IF_NONE_MATCH] = "if-none-match",
+    [CWEB_HEADER_KEEP_ALIVE] = "keep-alive",
+    [CWEB_HEADER_LAST_MODIFIED] = "last-modified",
+    [CWEB_HEADER_LINK] = "link",
+    [CWEB_HEADER_LOCATION] = "location",
+    [CWEB_HEADER_ORIGIN] = "origin",
+    [CWEB_HEADER_PROXY_CONNECTION] = "proxy-connection",
+    [CWEB_HEADER_RANGE] = "range",
+    [CWEB_HEADER_REFERER] = "referer",
+    [CWEB_HEADER_SERVER] = "server",
+    [CWEB_HEADER_SET_COOKIE] = "set-cookie",
+    [CWEB_HEADER_TRANSFER_ENCODING] = "transfer-encoding",
+    [CWEB_HEADER_UPGRADE] = "upgrade",
+    [CWEB_HEADER_USER_AGENT] = "user-agent",
+    [CWEB_HEADER_VARY] = "vary",
+    [CWEB_HEADER_X_CONTENT_TYPE_OPTIONS] = "x-content-type-options",
+};
+
+// Open addressing, at most a quarter full
+#define HEADER_TABLE_SIZE 128
+
+static uint8_t header_table[HEADER_TABLE_SIZE];
+static uint8_t header_lengths[CWEB_HEADER_COUNT];
+
+// Setting 0x20 lowercases letters. It also merges a few other pairs, but
+// of those only letters, digits and '-' (never confused: the partners are
+// control characters) occur in known names.
+#define FOLD(c) ((unsigned char)(c) | 0x20u)
+#define FOLD8 0x2020202020202020ull
+
+// Length, first and last character: cheap enough to run on every parsed
+// name and already unique among most known ones
+uint32_t http_header_hash(const char *name, size_t len) {
+    if (len == 0) return 0;
+    return (uint32_t)len << 16 | FOLD(name[0]) << 8 | FOLD(name[len - 1]);
+}
+
+static inline uint32_t header_slot_of(uint32_t hash) {
+    return ((hash >> 16) * 31 + ((hash >> 8) & 0xff) * 7 + (hash & 0xff)) % HEADER_TABLE_SIZE;
+}
+
+__attribute__((constructor)) static void header_table_init(void) {
+    for (int id = 1; id < CWEB_HEADER_COUNT; id++) {
+        size_t len = strlen(header_names[id]);
+        header_lengths[id] = (uint8_t)len;
+        uint32_t slot = header_slot_of(http_header_hash(header_names[id], len));
+        while (header_table[slot]) slot = (slot + 1) % HEADER_TABLE_SIZE;
+        header_table[slot] = (uint8_t)id;
+    }
+}
+
+// name against the lowercase spelling of a known header, 8 bytes a step
+static bool header_equal(const char *lower, const char *name, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, lower + i, 8);
+        memcpy(&b, name + i, 8);
+        if ((b | FOLD8) != a) return false;
+    }
+    for (; i < len; i++) {
+        if (FOLD(name[i]) != (unsigned char)lower[i]) return false;
+    }
+    return true;
+}
+
+HeaderId http_header_classify(const char *name, size_t len, uint32_t *hash) {
+    uint32_t h = http_header_hash(name, len);
+    *hash = h;
+    for (uint32_t slot = header_slot_of(h); header_table[slot]; slot = (slot + 1) % HEADER_TABLE_SIZE) {
+        HeaderId id = (HeaderId)header_table[slot];
+        if (header_lengths[id] == len && header_equal(http_header_names_lower[id], name, len)) return id;
+    }
+    return CWEB_HEADER_UNKNOWN;
+}
+
+HeaderId cweb_header_id(const char *name, size_t len) {
+    uint32_t hash;
+    return http_header_classify(name, len, &hash);
+}
+
+const char* cweb_header_name(HeaderId id) {
+    return (unsigned)id < CWEB_HEADER_COUNT ? header_names[id] : "";
+}
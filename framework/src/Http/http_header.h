@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#ifndef CWEB_HTTP_HEADER_H
+#define CWEB_HTTP_HEADER_H
+
+#include <cweb/http.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Id of name[0..len) and its case-insensitive hash, for Header.id / .hash
+HeaderId http_header_classify(const char *name, size_t len, uint32_t *hash);
+// Case-insensitive hash of name[0..len)
+uint32_t http_header_hash(const char *name, size_t len);
+
+// Lowercase spellings for HTTP/2
+extern const char *const http_header_names_lower[CWEB_HEADER_COUNT];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CWEB_HTTP_HEADER_H */
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/http.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Parameters beyond this are ignored, like headers beyond MAX_HEADERS
+#define QUERY_MAX_PARAMS 64
+
+typedef struct {
+    const char *key;
+    const char *value;
+    uint32_t key_len;
+    uint32_t value_len;
+    uint32_t hash;
+} QuerySlice;
+
+// params[count], then an open addressing table holding 1 + index per slot.
+// It is at most half full, a lookup hashes the key and mostly compares once.
+struct HttpQuery {
+    int count;
+    uint32_t mask;
+    uint8_t *slots;
+    QuerySlice params[];
+};
+
+// FNV-1a
+static uint32_t query_hash(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes into the arena ('+' is a space, malformed escapes stay as they are)
+static const char *query_decode(Request *req, const char *s, size_t len, uint32_t *out_len) {
+    char *out = cweb_request_alloc(req, len);
+    if (!out) return NULL;
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        int hi, lo;
+        if (s[i] == '%' && len - i > 2 && (hi = hex_value(s[i + 1])) >= 0 && (lo = hex_value(s[i + 2])) >= 0) {
+            out[n++] = (char)(hi << 4 | lo);
+            i += 2;
+        } else {
+            out[n++] = s[i] == '+' ? ' ' : s[i];
+        }
+    }
+    *out_len = (uint32_t)n;
+    return out;
+}
+
+static const QuerySlice *query_find(const struct HttpQuery *q, const char *key, size_t key_len, uint32_t hash) {
+    for (uint32_t i = hash & q->mask; q->slots[i]; i = (i + 1) & q->mask) {
+        const QuerySlice *p = &q->params[q->slots[i] - 1];
+        if (p->hash == hash && p->key_len == key_len && memcmp(p->key, key, key_len) == 0) return p;
+    }
+    return NULL;
+}
+
+// Parses the query of req->path into the arena. The first of repeated
+// keys wins, as with headers.
+static struct HttpQuery *query_parse(Request *req) {
+    const char *query = strchr(req->path, '?');
+    query = query ? query + 1 : "";
+
+    size_t max = 1;
+    for (const char *p = query; (p = strchr(p, '&')); p++) max++;
+    if (max > QUERY_MAX_PARAMS) max = QUERY_MAX_PARAMS;
+    uint32_t slots = 8;
+    while (slots < 2 * max) slots *= 2;
+
+    struct HttpQuery *q = cweb_request_alloc(req, sizeof(*q) + max * sizeof(QuerySlice) + slots);
+    if (!q) return NULL;
+    q->count = 0;
+    q->mask = slots - 1;
+    q->slots = (uint8_t *)&q->params[max];
+    memset(q->slots, 0, slots);
+
+    // One pass per parameter: slices point into the path, only escaped
+    // ones are decoded into the arena. The key hash is computed on the way.
+    const char *p = query;
+    while (*p && (size_t)q->count < max) {
+        QuerySlice *s = &q->params[q->count];
+        const char *key = p;
+        uint32_t hash = 2166136261u;
+        bool escaped = false;
+        for (; *p && *p != '&' && *p != '='; p++) {
+            escaped |= *p == '%' || *p == '+';
+            hash = (hash ^ (unsigned char)*p) * 16777619u;
+        }
+        s->key = key;
+        s->key_len = (uint32_t)(p - key);
+        if (escaped) {
+            s->key = query_decode(req, key, (size_t)(p - key), &s->key_len);
+            if (!s->key) return NULL;
+            hash = query_hash(s->key, s->key_len);
+        }
+        s->hash = hash;
+
+        s->value = "";
+        s->value_len = 0;
+        if (*p == '=') {
+            const char *value = ++p;
+            escaped = false;
+            for (; *p && *p != '&'; p++) escaped |= *p == '%' || *p == '+';
+            s->value = value;
+            s->value_len = (uint32_t)(p - value);
+            if (escaped && !(s->value = query_decode(req, value, s->value_len, &s->value_len))) return NULL;
+        }
+        if (*p == '&') p++;
+
+        if (s->key_len > 0 && !query_find(q, s->key, s->key_len, s->hash)) {
+            uint32_t i = s->hash & q->mask;
+            while (q->slots[i]) i = (i + 1) & q->mask;
+            q->slots[i] = (uint8_t)(q->count + 1);
+            q->count++;
+        }
+    }
+    return q;
+}
+
+bool cweb_get_query(Request *req, const char *key, const char **value, size_t *value_len) {
+    if (!req || !key) return false;
+    if (!req->query && !(req->query = query_parse(req))) return false;
+    size_t key_len = strlen(key);
+    const QuerySlice *s = query_find(req->query, key, key_len, query_hash(key, key_len));
+    if (!s) return false;
+    if (value) *value = s->value;
+    if (value_len) *value_len = s->value_len;
+    return true;
+}
+
+bool cweb_has_query(Request *req, const char *key) {
+    return cweb_get_query(req, key, NULL, NULL);
+}
+
+long cweb_get_query_long(Request *req, const char *key, long default_value) {
+    const char *value;
+    size_t len;
+    char digits[24];
+    if (!cweb_get_query(req, key, &value, &len) || len == 0 || len >= sizeof(digits)) return default_value;
+    memcpy(digits, value, len);
+    digits[len] = '\0';
+
+    char *end;
+    errno = 0;
+    long result = strtol(digits, &end, 10);
+    if (errno || *end || end == digits) return default_value;
+    return result;
+}
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/http.h>
+#include "http_scan.h"
+#include <string.h>
+
+// Header values and the request target make up most of a head, the SIMD
+// kernels look at 16 (SSE4.2) or 32 (AVX2) of their bytes per step. Token
+// names are short, both SIMD levels use the SSE4.2 range compare for them.
+// The tail of the head (less than one vector) always goes byte by byte.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HTTP_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+const unsigned char http_char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    4, 7, 6, 7, 7, 7, 7, 7, 6, 6, 7, 7, 6, 7, 7, 6,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 6, 6, 6,
+    6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 7, 6, 7, 0,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+};
+
+static char *scan_token_scalar(char *p, const char *end) {
+    (void)end;
+    while (http_char_class[(unsigned char)*p] & HTTP_TCHAR) p++;
+    return p;
+}
+
+static char *scan_target_scalar(char *p, const char *end) {
+    (void)end;
+    while (http_char_class[(unsigned char)*p] & HTTP_VCHAR) p++;
+    return p;
+}
+
+static char *scan_field_scalar(char *p, const char *end) {
+    (void)end;
+    while (http_char_class[(unsigned char)*p] & HTTP_FIELD) p++;
+    return p;
+}
+
+#ifdef HTTP_SCAN_X86
+
+#define SSE42_RANGES (_SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT)
+
+// Range tables are loaded as one 16 byte vector, only the first n count
+
+// pcmpestri takes at most 8 ranges. These cover every non-tchar byte plus
+// '|' and '~', which the table then lets through.
+__attribute__((target("sse4.2")))
+static char *scan_token_sse42(char *p, const char *end) {
+    static const char stop[17] = "\x00\x20\"\"()\x2c\x2c//:@[]{\xff";
+    const __m128i ranges = _mm_loadu_si128((const __m128i *)stop);
+    while (end - p >= 16) {
+        int i = _mm_cmpestri(ranges, 16, _mm_loadu_si128((const __m128i *)p), 16, SSE42_RANGES);
+        p += i;
+        if (i == 16) continue;
+        if (!(http_char_class[(unsigned char)*p] & HTTP_TCHAR)) return p;
+        p++;
+    }
+    return scan_token_scalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+static char *scan_target_sse42(char *p, const char *end) {
+    static const char stop[17] = "\x00\x20\x7f\xff";
+    const __m128i ranges = _mm_loadu_si128((const __m128i *)stop);
+    while (end - p >= 16) {
+        int i = _mm_cmpestri(ranges, 4, _mm_loadu_si128((const __m128i *)p), 16, SSE42_RANGES);
+        if (i != 16) return p + i;
+        p += 16;
+    }
+    return scan_target_scalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+static char *scan_field_sse42(char *p, const char *end) {
+    static const char stop[17] = "\x00\x08\x0a\x1f\x7f\x7f";
+    const __m128i ranges = _mm_loadu_si128((const __m128i *)stop);
+    while (end - p >= 16) {
+        int i = _mm_cmpestri(ranges, 6, _mm_loadu_si128((const __m128i *)p), 16, SSE42_RANGES);
+        if (i != 16) return p + i;
+        p += 16;
+    }
+    return scan_field_scalar(p, end);
+}
+
+// AVX2 has no range compare: bytes <= x are those where max(v, x) == x
+__attribute__((target("avx2")))
+static char *scan_target_avx2(char *p, const char *end) {
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i low = _mm256_cmpeq_epi8(_mm256_max_epu8(v, space), space);
+        __m256i high = _mm256_cmpeq_epi8(_mm256_min_epu8(v, del), del);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(low, high));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return scan_target_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static char *scan_field_avx2(char *p, const char *end) {
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i bad = _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctl), ctl);
+        bad = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), bad);
+        bad = _mm256_or_si256(bad, _mm256_cmpeq_epi8(v, del));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(bad);
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return scan_field_scalar(p, end);
+}
+
+#endif /* HTTP_SCAN_X86 */
+
+static const HttpScanKernel scan_kernels[] = {
+#ifdef HTTP_SCAN_X86
+    { "avx2", scan_token_sse42, scan_target_avx2, scan_field_avx2 },
+    { "sse4.2", scan_token_sse42, scan_target_sse42, scan_field_sse42 },
+#endif
+    { "scalar", scan_token_scalar, scan_target_scalar, scan_field_scalar },
+};
+
+#define SCAN_KERNEL_COUNT (sizeof(scan_kernels) / sizeof(scan_kernels[0]))
+
+const HttpScanKernel *http_scan = &scan_kernels[SCAN_KERNEL_COUNT - 1];
+
+static bool scan_kernel_supported(const HttpScanKernel *kernel) {
+#ifdef HTTP_SCAN_X86
+    if (strcmp(kernel->name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(kernel->name, "sse4.2") == 0) return __builtin_cpu_supports("sse4.2");
+#endif
+    (void)kernel;
+    return true;
+}
+
+// Before main, so the workers never see the pointer change
+__attribute__((constructor)) static void http_scan_select(void) {
+#ifdef HTTP_SCAN_X86
+    __builtin_cpu_init();
+#endif
+    for (size_t i = 0; i < SCAN_KERNEL_COUNT; i++) {
+        if (scan_kernel_supported(&scan_kernels[i])) {
+            http_scan = &scan_kernels[i];
+            return;
+        }
+    }
+}
+
+const char *cweb_http_scan_kernel(void) {
+    return http_scan->name;
+}
+
+bool cweb_http_use_scan_kernel(const char *name) {
+    for (size_t i = 0; i < SCAN_KERNEL_COUNT; i++) {
+        if (strcmp(scan_kernels[i].name, name) == 0 && scan_kernel_supported(&scan_kernels[i])) {
+            http_scan = &scan_kernels[i];
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#ifndef CWEB_HTTP_SCAN_H
+#define CWEB_HTTP_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scanning kernels of the request head parser. Each returns the first byte
+// at or after p outside its character class, never reading at or past end.
+// The head ends in CRLF CRLF, so there always is such a byte before end.
+
+// Character classes of RFC 9110 / 9112, one lookup per byte
+#define HTTP_TCHAR 1 // Method and header names
+#define HTTP_VCHAR 2 // Request target (visible ASCII)
+#define HTTP_FIELD 4 // Header values: VCHAR, obs-text, SP and HTAB
+extern const unsigned char http_char_class[256];
+
+typedef struct {
+    const char *name;
+    char *(*scan_token)(char *p, const char *end);  // HTTP_TCHAR
+    char *(*scan_target)(char *p, const char *end); // HTTP_VCHAR
+    char *(*scan_field)(char *p, const char *end);  // HTTP_FIELD
+} HttpScanKernel;
+
+// Widest kernel the CPU supports, picked at load time
+extern const HttpScanKernel *http_scan;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CWEB_HTTP_SCAN_H */
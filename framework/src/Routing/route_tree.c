@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include "route_tree.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct RouteNode {
+    RouteNode **children; // Static edges, children[i] starts with indices[i]
+    char *indices;
+    int child_count;
+    RouteNode *param;     // ":name" edge, matches up to the next '/'
+    RouteNode *wildcard;  // "*name" edge, matches the rest of the path
+    Route *route;         // Route ending here
+    char **names;         // Parameter names of that route, in pattern order
+    int name_count;
+    size_t prefix_len;
+    char prefix[];        // Static bytes of this edge (empty for param/wildcard nodes)
+};
+
+static RouteNode *node_new(const char *prefix, size_t len) {
+    RouteNode *n = calloc(1, sizeof(*n) + len + 1);
+    if (!n) return NULL;
+    memcpy(n->prefix, prefix, len);
+    n->prefix_len = len;
+    return n;
+}
+
+static int node_add_child(RouteNode *n, RouteNode *child) {
+    RouteNode **children = realloc(n->children, (n->child_count + 1) * sizeof(*children));
+    if (!children) return -1;
+    n->children = children;
+    char *indices = realloc(n->indices, n->child_count + 1);
+    if (!indices) return -1;
+    n->indices = indices;
+    n->children[n->child_count] = child;
+    n->indices[n->child_count] = child->prefix[0];
+    n->child_count++;
+    return 0;
+}
+
+// Moves everything behind prefix[at] into a new child of n
+static int node_split(RouteNode *n, size_t at) {
+    RouteNode *child = node_new(n->prefix + at, n->prefix_len - at);
+    if (!child) return -1;
+    *child = (RouteNode){ n->children, n->indices, n->child_count, n->param, n->wildcard,
+                          n->route, n->names, n->name_count, n->prefix_len - at };
+    RouteNode tail = *n;
+    *n = (RouteNode){ .prefix_len = at };
+    if (node_add_child(n, child) != 0) {
+        free(n->children);
+        free(n->indices);
+        memcpy(n, &tail, sizeof(tail));
+        free(child);
+        return -1;
+    }
+    return 0;
+}
+
+// Node at the end of s, splitting and adding static edges on the way
+static RouteNode *insert_static(RouteNode *n, const char *s, size_t len) {
+    for (;;) {
+        size_t common = 0;
+        while (common < len && common < n->prefix_len && s[common] == n->prefix[common]) common++;
+        if (common < n->prefix_len && node_split(n, common) != 0) return NULL;
+        s += common;
+        len -= common;
+        if (len == 0) return n;
+
+        const char *hit = n->child_count ? memchr(n->indices, *s, n->child_count) : NULL;
+        if (!hit) {
+            RouteNode *child = node_new(s, len);
+            if (!child || node_add_child(n, child) != 0) {
+                free(child);
+                return NULL;
+            }
+            return child;
+        }
+        n = n->children[hit - n->indices];
+    }
+}
+
+int route_tree_insert(RouteNode **root, const char *pattern, Route *route) {
+    if (!*root && !(*root = node_new("", 0))) return -1;
+
+    RouteNode *n = *root;
+    const char *names[CWEB_MAX_ROUTE_PARAMS];
+    size_t name_lens[CWEB_MAX_ROUTE_PARAMS];
+    int name_count = 0;
+    const char *p = pattern;
+    while (*p) {
+        // ':' and '*' only start a parameter right after a '/'
+        const char *q = p;
+        while (*q && !((*q == ':' || *q == '*') && q > pattern && q[-1] == '/')) q++;
+        if (q > p && !(n = insert_static(n, p, (size_t)(q - p)))) return -1;
+        if (!*q) break;
+
+        char kind = *q++;
+        size_t name_len = strcspn(q, "/");
+        if (name_count == CWEB_MAX_ROUTE_PARAMS) return -1;
+        names[name_count] = q;
+        name_lens[name_count++] = name_len;
+        p = q + name_len;
+
+        RouteNode **edge = kind == ':' ? &n->param : &n->wildcard;
+        if ((kind == ':' && name_len == 0) || (kind == '*' && *p)) return -1; // Catch-all goes last
+        if (!*edge && !(*edge = node_new("", 0))) return -1;
+        n = *edge;
+    }
+
+    if (n->route) return 1;
+    if (name_count > 0) {
+        n->names = calloc(name_count, sizeof(*n->names));
+        if (!n->names) return -1;
+        for (int i = 0; i < name_count; i++) {
+            if (!(n->names[i] = strndup(names[i], name_lens[i]))) {
+                while (i--) free(n->names[i]);
+                free(n->names);
+                n->names = NULL;
+                return -1;
+            }
+        }
+    }
+    n->name_count = name_count;
+    n->route = route;
+    return 0;
+}
+
+static const RouteNode *node_match(const RouteNode *n, const char *p, const char *end, RouteParam *params, int *count) {
+    if ((size_t)(end - p) < n->prefix_len || memcmp(p, n->prefix, n->prefix_len) != 0) return NULL;
+    p += n->prefix_len;
+
+    if (p == end) {
+        if (n->route) return n;
+    } else if (n->child_count) {
+        const char *hit = memchr(n->indices, *p, n->child_count);
+        const RouteNode *found = hit ? node_match(n->children[hit - n->indices], p, end, params, count) : NULL;
+        if (found) return found;
+    }
+
+    if (n->param && p < end && *p != '/' && *count < CWEB_MAX_ROUTE_PARAMS) {
+        const char *segment_end = memchr(p, '/', (size_t)(end - p));
+        if (!segment_end) segment_end = end;
+        int saved = (*count)++;
+        params[saved].value = p;
+        params[saved].value_len = (size_t)(segment_end - p);
+        const RouteNode *found = node_match(n->param, segment_end, end, params, count);
+        if (found) return found;
+        *count = saved;
+    }
+
+    if (n->wildcard && n->wildcard->route && *count < CWEB_MAX_ROUTE_PARAMS) {
+        params[*count].value = p;
+        params[*count].value_len = (size_t)(end - p);
+        (*count)++;
+        return n->wildcard;
+    }
+    return NULL;
+}
+
+Route *route_tree_match(const RouteNode *root, const char *path, size_t len, RouteParam *params, int *param_count) {
+    *param_count = 0;
+    const RouteNode *n = root ? node_match(root, path, path + len, params, param_count) : NULL;
+    if (!n) {
+        *param_count = 0;
+        return NULL;
+    }
+    for (int i = 0; i < *param_count; i++) {
+        params[i].name = i < n->name_count ? n->names[i] : "";
+    }
+    return n->route;
+}
+
+void route_tree_free(RouteNode *root) {
+    if (!root) return;
+    for (int i = 0; i < root->child_count; i++) route_tree_free(root->children[i]);
+    route_tree_free(root->param);
+    route_tree_free(root->wildcard);
+    for (int i = 0; i < root->name_count; i++) free(root->names[i]);
+    free(root->names);
+    free(root->children);
+    free(root->indices);
+    free(root);
+}
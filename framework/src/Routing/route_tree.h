@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#ifndef CWEB_ROUTE_TREE_H
+#define CWEB_ROUTE_TREE_H
+
+#include <cweb/routing.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compressed radix tree over the route patterns. Static edges share their
+// prefixes, ":name" matches one non-empty segment and "*name" the rest of
+// the path. Static edges win over parameters, parameters over catch-alls.
+typedef struct RouteNode RouteNode;
+
+// Adds pattern for route, -1 on a malformed pattern or out of memory.
+// The first route registered for a pattern keeps it.
+int route_tree_insert(RouteNode **root, const char *pattern, Route *route);
+
+// Route matching path[0..len), captures go to params in pattern order.
+// Does not allocate.
+Route *route_tree_match(const RouteNode *root, const char *path, size_t len, RouteParam *params, int *param_count);
+
+void route_tree_free(RouteNode *root);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CWEB_ROUTE_TREE_H */
@@ -6,16 +6,25 @@
  */
 
 #include <cweb/routing.h>
+#include "route_tree.h"
+#include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <cweb/logger.h>
 #include <cweb/leak_detector.h>
 
-#define MAX_ROUTES 128
-
-static Route routes[MAX_ROUTES];
-static route_handler_t fallback_handler = NULL;
+// Registration order, each route allocated on its own so the tree can point at it
+static Route **routes = NULL;
 static int route_count = 0;
+static int route_capacity = 0;
+static RouteNode *route_tree = NULL;
+static route_handler_t fallback_handler = NULL;
+
+// Generated by `cweb build`, an entry without handler was moved by cweb_rewriteRoutePath
+static Route *static_routes = NULL;
+static size_t static_route_count = 0;
+static static_route_lookup_t static_route_lookup = NULL;
 
 
 #define MAX_ASSET_FUNCTIONS 128
@@ -23,41 +32,203 @@ static int route_count = 0;
 static void (*asset_functions[MAX_ASSET_FUNCTIONS])(void);
 static size_t asset_function_count = 0;
 
-void cweb_set_dynamic_subpath(char *path, int set_dynamic) {
+static bool is_static_route(const Route *route) {
+	return static_route_count > 0 && route >= static_routes && route < static_routes + static_route_count;
+}
+
+static bool route_has_handler(const Route *route) {
+	if (route->handler) return true;
+	for (int i = 0; i < CWEB_METHOD_COUNT; i++) {
+		if (route->method_handlers[i]) return true;
+	}
+	return false;
+}
+
+// Static routes are checked first, like when matching
+static Route *find_registered_route(const char *path) {
+	for (size_t i = 0; i < static_route_count; i++) {
+		if (route_has_handler(&static_routes[i]) && strcmp(static_routes[i].path, path) == 0) {
+			return &static_routes[i];
+		}
+	}
 	for (int i = 0; i < route_count; i++) {
-		if (strcmp(routes[i].path, path) == 0) {
-			routes[i].has_dynamic_subpath = set_dynamic;
-			LOG_DEBUG("ROUTING", "Set dynamic subpath for %s to %d", path, set_dynamic);
-			return;
+		if (strcmp(routes[i]->path, path) == 0) {
+			return routes[i];
 		}
 	}
+	return NULL;
+}
+
+// Static routes only need the tree for their dynamic subpath
+static void index_route(Route *route) {
+	int rc = is_static_route(route) ? 0 : route_tree_insert(&route_tree, route->path, route);
+	if (rc < 0) {
+		LOG_ERROR("ROUTING", "Invalid route pattern or out of memory: %s", route->path);
+	} else if (rc > 0) {
+		LOG_WARNING("ROUTING", "Route %s registered twice, the first one is used", route->path);
+	}
+
+	if (route->has_dynamic_subpath) {
+		char pattern[MAX_PATH_LEN];
+		size_t len = strlen(route->path);
+		const char *slash = len > 0 && route->path[len - 1] == '/' ? "" : "/";
+		if (snprintf(pattern, sizeof(pattern), "%s%s*", route->path, slash) >= (int)sizeof(pattern) ||
+			route_tree_insert(&route_tree, pattern, route) < 0) {
+			LOG_ERROR("ROUTING", "Could not add dynamic subpath for %s", route->path);
+		}
+	}
+}
+
+// Paths and flags are only set up before serving, rebuilding is cheap enough
+static void rebuild_route_tree(void) {
+	route_tree_free(route_tree);
+	route_tree = NULL;
+	for (size_t i = 0; i < static_route_count; i++) {
+		if (route_has_handler(&static_routes[i])) {
+			index_route(&static_routes[i]);
+		}
+	}
+	for (int i = 0; i < route_count; i++) {
+		index_route(routes[i]);
+	}
+}
+
+void cweb_set_static_routes(Route *table, size_t count, static_route_lookup_t lookup) {
+	static_routes = table;
+	static_route_count = table && lookup ? count : 0;
+	static_route_lookup = static_route_count ? lookup : NULL;
+	rebuild_route_tree();
+	LOG_DEBUG("ROUTING", "Using %zu static routes", static_route_count);
+}
+
+void cweb_set_dynamic_subpath(char *path, int set_dynamic) {
+	Route *route = find_registered_route(path);
+	if (route) {
+		route->has_dynamic_subpath = set_dynamic;
+		rebuild_route_tree();
+		LOG_DEBUG("ROUTING", "Set dynamic subpath for %s to %d", path, set_dynamic);
+		return;
+	}
 	LOG_WARNING("ROUTING", "Route not found for setting dynamic subpath: %s", path);
 }
 
 void cweb_set_dynamic_param(char *path, int set_dynamic) {
-	for (int i = 0; i < route_count; i++) {
-		if (strcmp(routes[i].path, path) == 0) {
-			routes[i].has_dynamic_param = set_dynamic;
-			LOG_DEBUG("ROUTING", "Set dynamic param for %s to %d", path, set_dynamic);
-			return;
-		}
+	Route *route = find_registered_route(path);
+	if (route) {
+		route->has_dynamic_param = set_dynamic;
+		LOG_DEBUG("ROUTING", "Set dynamic param for %s to %d", path, set_dynamic);
+		return;
 	}
 	LOG_WARNING("ROUTING", "Route not found for setting dynamic param: %s", path);
 }
 
+void cweb_set_body_handler(char *path, body_handler_t handler) {
+	Route *route = find_registered_route(path);
+	if (route) {
+		route->body_handler = handler;
+		LOG_DEBUG("ROUTING", "Set body handler for %s", path);
+		return;
+	}
+	LOG_WARNING("ROUTING", "Route not found for setting body handler: %s", path);
+}
+
+void cweb_set_route_timeout(char *path, int seconds) {
+	Route *route = find_registered_route(path);
+	if (route) {
+		route->timeout = seconds;
+		LOG_DEBUG("ROUTING", "Set timeout for %s to %ds", path, seconds);
+		return;
+	}
+	LOG_WARNING("ROUTING", "Route not found for setting timeout: %s", path);
+}
+
+void cweb_set_route_cache(char *path, int ttl_seconds, int stale_seconds, const char *query_keys) {
+	Route *route = find_registered_route(path);
+	if (!route) {
+		LOG_WARNING("ROUTING", "Route not found for setting cache: %s", path);
+		return;
+	}
+	char *query = query_keys && query_keys[0] ? strdup(query_keys) : NULL;
+	if (query_keys && query_keys[0] && !query) {
+		LOG_ERROR("ROUTING", "Out of memory. Cannot cache route: %s", path);
+		return;
+	}
+	free(route->cache_query);
+	route->cache_query = query;
+	route->cache_ttl = ttl_seconds > 0 ? ttl_seconds : 0;
+	route->cache_stale = stale_seconds > 0 ? stale_seconds : 0;
+	LOG_DEBUG("ROUTING", "Set cache for %s to %ds (+%ds stale)", path, route->cache_ttl, route->cache_stale);
+}
+
+void cweb_set_route_coalesce(char *path, bool coalesce, const char *query_keys) {
+	Route *route = find_registered_route(path);
+	if (!route) {
+		LOG_WARNING("ROUTING", "Route not found for setting coalescing: %s", path);
+		return;
+	}
+	// Cache and coalescing share one key: NULL keeps whatever is set, and
+	// the keys of a cached route are not changed behind its back
+	const char *current = route->cache_query ? route->cache_query : "";
+	if (query_keys && strcmp(query_keys, current) != 0) {
+		if (route->cache_ttl > 0) {
+			LOG_WARNING("ROUTING", "Keeping the cache query keys \"%s\" of %s, ignoring \"%s\"",
+			            current, path, query_keys);
+		} else {
+			char *query = query_keys[0] ? strdup(query_keys) : NULL;
+			if (query_keys[0] && !query) {
+				LOG_ERROR("ROUTING", "Out of memory. Cannot coalesce route: %s", path);
+				return;
+			}
+			free(route->cache_query);
+			route->cache_query = query;
+		}
+	}
+	route->coalesce = coalesce;
+	LOG_DEBUG("ROUTING", "Set coalescing for %s to %d", path, coalesce);
+}
+
+static Route *register_route(const char *path, HttpMethod method, route_handler_t handler, bool using_session);
+
 int cweb_rewriteRoutePath(char *current_path, char *new_path)
 {
-    for (int i = 0; i < route_count; i++) {
-        if (strcmp(routes[i].path, current_path) == 0) {
-            free(routes[i].path);
-            routes[i].path = strdup(new_path);
-            cweb_leak_tracker_record("routes[i].path", routes[i].path, strlen(routes[i].path), true);
-            LOG_DEBUG("ROUTING", "Route path rewritten from %s to %s",
-                        current_path, new_path);
-            return 0;
+    Route *route = find_registered_route(current_path);
+    if (route && is_static_route(route)) {
+        // The generated dispatch is fixed, the route lives on as an added one
+        Route *moved = register_route(new_path, CWEB_METHOD_UNKNOWN, route->handler, route->using_session);
+        if (!moved) {
+            return -1;
         }
+        memcpy(moved->method_handlers, route->method_handlers, sizeof(moved->method_handlers));
+        moved->has_dynamic_subpath = route->has_dynamic_subpath;
+        moved->has_dynamic_param = route->has_dynamic_param;
+        moved->body_handler = route->body_handler;
+        moved->timeout = route->timeout;
+        moved->cache_ttl = route->cache_ttl;
+        moved->cache_stale = route->cache_stale;
+        moved->cache_query = route->cache_query;
+        moved->coalesce = route->coalesce;
+        route->coalesce = false;
+        route->cache_query = NULL;
+        route->cache_ttl = 0;
+        route->handler = NULL;
+        memset(route->method_handlers, 0, sizeof(route->method_handlers));
+        rebuild_route_tree();
+        LOG_DEBUG("ROUTING", "Static route %s moved to %s", current_path, new_path);
+        return 0;
     }
-    return -1;
+
+    char *path = route ? strdup(new_path) : NULL;
+    if (!path) {
+        return -1;
+    }
+    cweb_leak_tracker_record("routes[i].path", route->path, strlen(route->path), false);
+    free(route->path);
+    route->path = path;
+    cweb_leak_tracker_record("routes[i].path", route->path, strlen(route->path), true);
+    rebuild_route_tree();
+    LOG_DEBUG("ROUTING", "Route path rewritten from %s to %s",
+                current_path, new_path);
+    return 0;
 }
 void cweb_register_frontend_asset_function(void (*func)(void)) {
     if (asset_function_count < MAX_ASSET_FUNCTIONS) {
@@ -79,104 +250,179 @@ void cweb_set_fallback_handler(route_handler_t handler) {
     fallback_handler = handler;
 }
 
+route_handler_t cweb_get_fallback_handler(void) {
+    return fallback_handler;
+}
+
+// Handler for method (CWEB_METHOD_UNKNOWN = any) on path, added to the
+// route of the same pattern if there is one
+static Route *register_route(const char *path, HttpMethod method, route_handler_t handler, bool using_session) {
+    Route *route = find_registered_route(path);
+    if (route) {
+        route_handler_t *slot = method ? &route->method_handlers[method] : &route->handler;
+        if (*slot) {
+            LOG_WARNING("ROUTING", "Route %s %s registered twice, the first one is used", cweb_http_method_name(method), path);
+            return route;
+        }
+        *slot = handler;
+        route->using_session |= using_session;
+        return route;
+    }
+
+    if (route_count == route_capacity) {
+        int capacity = route_capacity ? route_capacity * 2 : 32;
+        Route **grown = realloc(routes, capacity * sizeof(*grown));
+        if (!grown) {
+            LOG_FATAL("ROUTING", "Out of memory. Cannot add route: %s", path);
+            return NULL;
+        }
+        routes = grown;
+        route_capacity = capacity;
+    }
+
+    route = calloc(1, sizeof(*route));
+    if (!route || !(route->path = strdup(path))) {
+        free(route);
+        LOG_FATAL("ROUTING", "Out of memory. Cannot add route: %s", path);
+        return NULL;
+    }
+    cweb_leak_tracker_record("routes[i].path", route->path, strlen(route->path), true);
+    if (method) {
+        route->method_handlers[method] = handler;
+    } else {
+        route->handler = handler;
+    }
+    route->using_session = using_session;
+    routes[route_count++] = route;
+    index_route(route);
+    return route;
+}
+
 void cweb_add_route(const char *path, route_handler_t handler, bool using_session) {
     LOG_DEBUG("ROUTING", "Adding route: %s (requires session: %s)", path, using_session ? "true" : "false");
-    if (route_count < MAX_ROUTES) {
-        routes[route_count].path = strdup(path);
-        routes[route_count].handler = handler;
-        routes[route_count].using_session = using_session;
-		routes[route_count].has_dynamic_subpath = 0;
-		routes[route_count].has_dynamic_param = 0;
-        route_count++;
-       
-    } else {
-        LOG_FATAL("ROUTING", "Maximum route limit reached. Cannot add route: %s", path);
+    register_route(path, CWEB_METHOD_UNKNOWN, handler, using_session);
+}
+
+void cweb_add_method_route(HttpMethod method, const char *path, route_handler_t handler, bool using_session) {
+    if (method <= CWEB_METHOD_UNKNOWN || method >= CWEB_METHOD_COUNT) {
+        LOG_ERROR("ROUTING", "Invalid method for route: %s", path);
+        return;
     }
+    LOG_DEBUG("ROUTING", "Adding route: %s %s (requires session: %s)", cweb_http_method_name(method), path, using_session ? "true" : "false");
+    register_route(path, method, handler, using_session);
 }
 
-int has_path_subpath(const char *path) {
-    if (!path || path[0] == '\0') {
-        LOG_DEBUG("ROUTING", "Invalid path provided to has_path_subpath");
-        return 0;
+// "GET, HEAD, POST, OPTIONS" for the methods route answers
+static void route_allow(const Route *route, char *out, size_t size) {
+    size_t len = 0;
+    out[0] = '\0';
+    for (int m = CWEB_METHOD_GET; m < CWEB_METHOD_COUNT; m++) {
+        bool allowed = route->method_handlers[m] || m == CWEB_METHOD_OPTIONS ||
+                       (m == CWEB_METHOD_HEAD && route->method_handlers[CWEB_METHOD_GET]);
+        if (!allowed) continue;
+        int n = snprintf(out + len, size - len, "%s%s", len ? ", " : "", cweb_http_method_name((HttpMethod)m));
+        if (n < 0 || (size_t)n >= size - len) break;
+        len += (size_t)n;
     }
-    
-    // Finde das erste '?' um Query-Parameter zu ignorieren
-    const char *query_start = strchr(path, '?');
-    
-    // Finde das erste '/' 
-    const char *first_slash = strchr(path, '/');
-    if (!first_slash) {
-        LOG_DEBUG("ROUTING", "No slash found in path: %s", path);
-        return 0;
+}
+
+static void route_options(Request *req, Response *res) {
+    char allow[96];
+    route_allow(cweb_match_route(req), allow, sizeof(allow));
+    res->status_code = 204;
+    cweb_add_response_header(res, "Allow", allow);
+    res->state = PROCESSED;
+}
+
+static void route_method_not_allowed(Request *req, Response *res) {
+    char allow[96];
+    route_allow(cweb_match_route(req), allow, sizeof(allow));
+    res->status_code = 405;
+    res->body = "Method Not Allowed";
+    res->body_len = strlen(res->body);
+    res->isliteral = 1;
+    cweb_add_response_header(res, "Allow", allow);
+    cweb_add_response_header(res, "Content-Type", "text/plain");
+    res->state = PROCESSED;
+}
+
+route_handler_t cweb_route_handler(const Route *route, const Request *req) {
+    HttpMethod method = req->method_id;
+    route_handler_t handler = route->method_handlers[method];
+    if (!handler && method == CWEB_METHOD_HEAD) {
+        handler = route->method_handlers[CWEB_METHOD_GET];
     }
-    
-    // Suche nach einem weiteren '/' nach dem ersten, aber stoppe bei '?'
-    const char *search_start = first_slash + 1;
-    const char *search_end = query_start ? query_start : path + strlen(path);
-    
-    // Suche nur im Pfad-Teil (vor den Query-Parametern)
-    const char *second_slash = NULL;
-    for (const char *p = search_start; p < search_end; p++) {
-        if (*p == '/') {
-            second_slash = p;
-            break;
-        }
+    if (!handler) {
+        handler = route->handler;
+    }
+    if (!handler) {
+        handler = method == CWEB_METHOD_OPTIONS ? route_options : route_method_not_allowed;
     }
-    
-    int has_subpath = (second_slash != NULL);
-    
-    LOG_DEBUG("ROUTING", "Path %s %s subpath (query ignored)", path, has_subpath ? "has" : "has no");
-    return has_subpath;
+    return handler;
 }
 
-int has_path_param(const char *path) {
-    if (!path || path[0] == '\0') {
-        LOG_DEBUG("ROUTING", "Invalid path provided to has_path_param");
-        return 0;
+// Matches the path part of path, captures land in params
+static Route *find_route(const char *path, RouteParam *params, int *param_count) {
+    size_t len = strcspn(path, "?");
+    if (static_route_lookup) {
+        Route *route = static_route_lookup(path, len);
+        if (route && route_has_handler(route)) {
+            *param_count = 0;
+            return route;
+        }
     }
-    
-    int has_param = (strchr(path, '?') != NULL);
-    LOG_DEBUG("ROUTING", "Path %s %s parameters", path, has_param ? "has" : "has no");
-    return has_param;
+    return route_tree_match(route_tree, path, len, params, param_count);
 }
 
+const Route *cweb_match_route(Request *req) {
+    if (!req->route_matched) {
+        req->route = req->path ? find_route(req->path, req->params, &req->param_count) : NULL;
+        req->route_matched = true;
+    }
+    return req->route;
+}
 
-route_handler_t cweb_get_route_handler(const char *path, bool *using_session) {
-    if (path && path[0] == '\0')
-        return NULL;
+bool cweb_get_route_param(Request *req, const char *name, const char **value, size_t *value_len) {
+    if (!req || !name || !cweb_match_route(req)) return false;
+    for (int i = 0; i < req->param_count; i++) {
+        if (strcmp(req->params[i].name, name) == 0) {
+            if (value) *value = req->params[i].value;
+            if (value_len) *value_len = req->params[i].value_len;
+            return true;
+        }
+    }
+    return false;
+}
 
-    // Temporärer Speicher für den Basis-Pfad
-    AUTOFREE char *base_path = cweb_get_route_base((char *)path);
+long cweb_get_route_param_long(Request *req, const char *name, long default_value) {
+    const char *value;
+    size_t len;
+    char digits[24];
+    if (!cweb_get_route_param(req, name, &value, &len) || len == 0 || len >= sizeof(digits)) return default_value;
+    memcpy(digits, value, len);
+    digits[len] = '\0';
 
+    char *end;
+    errno = 0;
+    long result = strtol(digits, &end, 10);
+    if (errno || *end || end == digits) return default_value;
+    return result;
+}
 
-    // Suche nach einer passenden Route
-    for (int i = 0; i < route_count; i++) {
-        if (strcmp(routes[i].path, path) == 0) {
-            if (using_session) {
-                routes[i].using_session = *using_session;
-                LOG_INFO("ROUTING", "Route requires session: %s", routes[i].using_session ? "true" : "false");
-            }
-            LOG_DEBUG("ROUTING", "Handler found for path: %s", path);
-            return routes[i].handler;
-        }
-    }
+route_handler_t cweb_get_route_handler(const char *path, bool *using_session) {
+    if (!path || path[0] == '\0')
+        return NULL;
 
-	for (int i = 0; i < route_count; i++) {
-		LOG_DEBUG("ROUTING", "Checking route: %s against base path: %s", routes[i].path, base_path);
-        if (strcmp(routes[i].path, base_path) == 0) {
-			if (routes[i].has_dynamic_subpath && has_path_subpath(path)) {
-				if ((has_path_param(path) && routes[i].has_dynamic_param) || (!routes[i].has_dynamic_param && !has_path_param(path)) || !has_path_param(path)) {
-					LOG_DEBUG("ROUTING", "Dynamic subpath match for route: %s with path: %s", routes[i].path, path);
-					return routes[i].handler;
-				}
-			}
-			if (routes[i].has_dynamic_param && has_path_param(path)) {
-				if ((has_path_subpath(path) && routes[i].has_dynamic_subpath) || (!routes[i].has_dynamic_subpath && !has_path_subpath(path)) || !has_path_subpath(path)) {
-					LOG_DEBUG("ROUTING", "Dynamic param match for route: %s with path: %s", routes[i].path, path);
-					return routes[i].handler;
-				}
-			}
+    RouteParam params[CWEB_MAX_ROUTE_PARAMS];
+    int param_count;
+    Route *route = find_route(path, params, &param_count);
+    if (route) {
+        if (using_session) {
+            *using_session = route->using_session;
+            LOG_DEBUG("ROUTING", "Route requires session: %s", route->using_session ? "true" : "false");
         }
+        LOG_DEBUG("ROUTING", "Handler found for path: %s", path);
+        return route->handler ? route->handler : route->method_handlers[CWEB_METHOD_GET];
     }
 
     // Fallback-Handler verwenden, falls keine spezifische Route gefunden wurde
@@ -189,12 +435,46 @@ route_handler_t cweb_get_route_handler(const char *path, bool *using_session) {
     return NULL; // Kein Handler gefunden
 }
 
+body_handler_t cweb_get_body_handler(const char *path) {
+    if (!path || path[0] == '\0')
+        return NULL;
+
+    RouteParam params[CWEB_MAX_ROUTE_PARAMS];
+    int param_count;
+    Route *route = find_route(path, params, &param_count);
+    return route ? route->body_handler : NULL;
+}
+
+int cweb_get_route_timeout(const char *path) {
+    if (!path || path[0] == '\0')
+        return 0;
+
+    RouteParam params[CWEB_MAX_ROUTE_PARAMS];
+    int param_count;
+    Route *route = find_route(path, params, &param_count);
+    return route ? route->timeout : 0;
+}
+
 void cweb_clear_routes() {
+    route_tree_free(route_tree);
+    route_tree = NULL;
     for (int i = 0; i < route_count; i++) {
-        LOG_DEBUG("ROUTING", "Freeing route: %s", routes[i].path);
-        cweb_leak_tracker_record("routes[route_count].path", routes[i].path, strlen(routes[i].path), false);
-        free(routes[i].path);
+        LOG_DEBUG("ROUTING", "Freeing route: %s", routes[i]->path);
+        cweb_leak_tracker_record("routes[i].path", routes[i]->path, strlen(routes[i]->path), false);
+        free(routes[i]->path);
+        free(routes[i]->cache_query);
+        free(routes[i]);
     }
+    free(routes);
+    routes = NULL;
     route_count = 0;
+    route_capacity = 0;
+    for (size_t i = 0; i < static_route_count; i++) {
+        free(static_routes[i].cache_query);
+        static_routes[i].cache_query = NULL;
+    }
+    static_routes = NULL;
+    static_route_count = 0;
+    static_route_lookup = NULL;
     fallback_handler = NULL;
-}
\ No newline at end of file
+}
@@ -9,31 +9,195 @@
 #include <cweb/fileserver.h>
 #include <cweb/compress.h>
 #include <cweb/speedbench.h>
+#include <cweb/template.h>
+#include <cweb/fetch.h>
 #include "../../app/includes/cstyles.h"
 #include <cweb/leak_detector.h>
+#include "server_internal.h"
+#include "fileserver_internal.h"
+#include <pthread.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <netinet/tcp.h>
 
 // Forward declarations (Prototypen) für die Callbacks
 static void listener_cb(struct evconnlistener *listener, evutil_socket_t fd,
                         struct sockaddr *addr, int socklen, void *ctx);
 static void conn_read_cb(struct bufferevent *bev, void *ctx);
+static void conn_write_cb(struct bufferevent *bev, void *ctx);
 static void conn_event_cb(struct bufferevent *bev, short events, void *ctx);
 
-struct event_base *g_event_base = NULL;
+CWEB_THREAD_LOCAL struct event_base *g_event_base = NULL;
+
+// One event loop with its own SO_REUSEPORT listener per worker thread
+typedef struct {
+    int id;
+    pthread_t thread;
+    struct event_base *base;
+    struct evconnlistener *listener;
+    UringWorker *uring;         // Set instead of listener with IO_BACKEND_URING
+} ServerWorker;
+
+static ServerConfig server_settings = {
+    .worker_count = 1,
+    .keep_alive_timeout = 5,
+    .max_pipelined_requests = 16,
+    .max_body_size = 1024 * 1024,
+    .max_header_size = READ_BUFFER_SIZE * 4,
+    .max_connections = 10000,
+    .read_timeout = 30,
+    .write_timeout = 30,
+    .header_timeout = 10,
+    .output_high_watermark = 1024 * 1024,
+    .async_timeout = 30,
+    .response_cache_size = 64 * 1024 * 1024,
+    .io_backend = IO_BACKEND_LIBEVENT,
+    .http2 = false,
+    .tls_cert_file = NULL,
+    .tls_key_file = NULL
+};
+static ServerWorker workers[CWEB_MAX_WORKERS];
+static CWEB_THREAD_LOCAL int current_worker_id = -1;
+static atomic_int active_connections = 0; // Shared by all workers for max_connections
 
 
 struct event_base *cweb_get_event_base() {
     return g_event_base;
 }
 
-void cweb_run_server(const char *port) {
-    // Create the main event loop
-    g_event_base = event_base_new();
-    if (!g_event_base) {
+int cweb_get_worker_id(void) {
+    return current_worker_id;
+}
+
+ServerConfig cweb_default_server_config(void) {
+    ServerConfig config = {0};
+    config.worker_count = 1;
+    config.keep_alive_timeout = 5;
+    config.max_pipelined_requests = 16;
+    config.max_body_size = 1024 * 1024;
+    config.max_header_size = READ_BUFFER_SIZE * 4;
+    config.max_connections = 10000;
+    config.read_timeout = 30;
+    config.write_timeout = 30;
+    config.header_timeout = 10;
+    config.output_high_watermark = 1024 * 1024;
+    config.async_timeout = 30;
+    config.response_cache_size = 64 * 1024 * 1024;
+    config.io_backend = IO_BACKEND_LIBEVENT;
+    config.http2 = false;
+    config.tls_cert_file = NULL;
+    config.tls_key_file = NULL;
+    return config;
+}
+
+void cweb_server_configure(const ServerConfig *config) {
+    if (!config) return;
+    server_settings = *config;
+    if (server_settings.keep_alive_timeout < 0) server_settings.keep_alive_timeout = 0;
+    if (server_settings.max_pipelined_requests < 1) server_settings.max_pipelined_requests = 1;
+    if (server_settings.max_header_size == 0) server_settings.max_header_size = READ_BUFFER_SIZE * 4;
+    if (server_settings.max_connections < 0) server_settings.max_connections = 0;
+    if (server_settings.read_timeout < 0) server_settings.read_timeout = 0;
+    if (server_settings.write_timeout < 0) server_settings.write_timeout = 0;
+    if (server_settings.header_timeout < 0) server_settings.header_timeout = 0;
+    if (server_settings.async_timeout < 0) server_settings.async_timeout = 0;
+}
+
+int server_async_timeout(void) {
+    return server_settings.async_timeout;
+}
+
+size_t server_response_cache_size(void) {
+    return server_settings.response_cache_size;
+}
+
+size_t server_output_high_watermark(void) {
+    return server_settings.output_high_watermark;
+}
+
+static int resolve_worker_count(void) {
+    int count = server_settings.worker_count;
+    if (count <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cpus > 0 ? (int)cpus : 1;
+    }
+    if (count > CWEB_MAX_WORKERS) {
+        LOG_WARNING("SERVER", "worker_count %d exceeds limit, using %d", count, CWEB_MAX_WORKERS);
+        count = CWEB_MAX_WORKERS;
+    }
+    return count;
+}
+
+static int worker_open(ServerWorker *worker, int id, struct sockaddr_in *sin, bool reuse_port) {
+    worker->id = id;
+    worker->base = event_base_new();
+    if (!worker->base) {
         fprintf(stderr, "Could not initialize libevent!\n");
-        exit(1);
+        return -1;
+    }
+
+    if (server_settings.io_backend == IO_BACKEND_URING) {
+        worker->uring = server_uring_open(worker->base, sin, reuse_port);
+        if (worker->uring) return 0;
+        LOG_WARNING("SERVER", "io_uring unavailable, worker %d falls back to libevent", id);
     }
-    printf("Event base created.\n");
-    cweb_init_pending_responses(g_event_base);
+
+    // With several workers every loop binds its own socket to the same port
+    // and the kernel spreads incoming connections across them.
+    unsigned flags = LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE;
+    if (reuse_port) {
+        flags |= LEV_OPT_REUSEABLE_PORT;
+    }
+
+    worker->listener = evconnlistener_new_bind(
+        worker->base, listener_cb, worker, flags, -1,
+        (struct sockaddr*)sin, sizeof(*sin));
+    if (!worker->listener) {
+        perror("Couldn't create listener");
+        event_base_free(worker->base);
+        worker->base = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void *worker_loop(void *arg) {
+    ServerWorker *worker = arg;
+    current_worker_id = worker->id;
+    g_event_base = worker->base;
+    LOG_DEBUG("SERVER", "Worker %d running", worker->id);
+
+    // Start the event loop. This function only returns on error.
+    int ret = event_base_dispatch(worker->base);
+    if (ret == -1) {
+        fprintf(stderr, "Error running event loop (worker %d)\n", worker->id);
+    } else if (ret == 1) {
+        fprintf(stderr, "No events were registered (worker %d)\n", worker->id);
+    }
+
+    // Per-worker cleanup
+    server_cache_release_flights();
+    cweb_cleanup_pending_responses();
+    cweb_output_cleanup();
+    cweb_http_pool_cleanup();
+    cweb_fileserver_release_open_files();
+    if (worker->uring) {
+        server_uring_close(worker->uring);
+        worker->uring = NULL;
+    } else {
+        evconnlistener_free(worker->listener);
+        worker->listener = NULL;
+    }
+    event_base_free(worker->base);
+    worker->base = NULL;
+    g_event_base = NULL;
+    current_worker_id = -1;
+    return NULL;
+}
+
+void cweb_run_server(const char *port) {
+    int worker_count = resolve_worker_count();
 	cweb_init_speedbench();
 
     struct sockaddr_in sin;
@@ -42,133 +206,296 @@ void cweb_run_server(const char *port) {
     sin.sin_addr.s_addr = htonl(0);
     sin.sin_port = htons(atoi(port));
 
-    // Create a listener to accept new connections
-    struct evconnlistener *listener = evconnlistener_new_bind(
-        g_event_base, listener_cb, NULL,
-        LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
-        (struct sockaddr*)&sin, sizeof(sin));
+    if (server_settings.http2 && !server_h2_available()) {
+        LOG_WARNING("SERVER", "Built without nghttp2, HTTP/2 stays off");
+        server_settings.http2 = false;
+    }
+    if (server_settings.tls_cert_file && server_settings.tls_key_file) {
+        if (!server_tls_available()) {
+            LOG_ERROR("SERVER", "Built without OpenSSL, cannot serve HTTPS");
+            exit(1);
+        }
+        if (server_tls_init(server_settings.tls_cert_file, server_settings.tls_key_file, server_settings.http2) != 0) {
+            exit(1);
+        }
+    }
+    // io_uring, HTTP/2 framing and TLS send from memory, file bodies have to
+    // be mapped instead
+    if (server_settings.io_backend == IO_BACKEND_URING || server_settings.http2 || server_tls_enabled()) {
+        fdcache_disable_sendfile();
+    }
 
-    if (!listener) {
-        perror("Couldn't create listener");
-        exit(1);
+    // Create one event loop and listener per worker
+    for (int i = 0; i < worker_count; i++) {
+        if (worker_open(&workers[i], i, &sin, worker_count > 1) != 0) {
+            exit(1);
+        }
     }
-    
-    LOG_INFO("SERVER", "port %s", port);
-    printf("\n\n "fg_green vconnection RESET " RUNNING on " fg_cyan underline "http://localhost:%s\n\n" RESET, port);
+    printf("Event base created (%d worker%s).\n", worker_count, worker_count == 1 ? "" : "s");
 
-    // Start the event loop. This function only returns on error.
-    int ret = event_base_dispatch(g_event_base);
-    if (ret == -1) {
-        fprintf(stderr, "Error running event loop\n");
-    } else if (ret == 1) {
-        fprintf(stderr, "No events were registered\n");
+    // older libcurl versions do not initialise thread-safely, so do it once
+    // before any worker can call fetch()
+    if (worker_count > 1 && fetch_global_init() != FETCH_OK) {
+        LOG_WARNING("SERVER", "fetch_global_init failed");
     }
 
-    // Cleanup
-    cweb_cleanup_pending_responses();
+    LOG_INFO("SERVER", "port %s, workers %d", port, worker_count);
+    printf("\n\n "fg_green vconnection RESET " RUNNING on " fg_cyan underline "%s://localhost:%s\n\n" RESET,
+           server_tls_enabled() ? "https" : "http", port);
+
+    // Worker 0 runs on the calling thread, the others get their own
+    for (int i = 1; i < worker_count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_loop, &workers[i]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    worker_loop(&workers[0]);
+    for (int i = 1; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    if (worker_count > 1) {
+        fetch_global_cleanup();
+    }
+    server_tls_cleanup();
     LOG_INFO("SERVER", "End of server execution, cleaning up resources");
-    evconnlistener_free(listener);
-    event_base_free(g_event_base);
-    g_event_base = NULL;
 }
 
-// This callback is executed when a new TCP connection is accepted.
-static void listener_cb(struct evconnlistener *listener, evutil_socket_t fd,
-                        struct sockaddr *addr, int socklen, void *ctx) {
+// Upper bound for a chunk-size or trailer line
+#define MAX_CHUNK_LINE_SIZE 1024
 
-    // TODO HJEREEE!!
-    (void )ctx;
-    (void)socklen; 
+static void connection_process_input(Connection *conn);
 
-    struct sockaddr_in *sin = (struct sockaddr_in*)addr;
-    char ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &sin->sin_addr, ip, sizeof(ip));
-    LOG_INFO("SERVER", "New connection from %s:%d", ip, ntohs(sin->sin_port));
+Connection *server_connection_from_bev(struct bufferevent *bev) {
+    bufferevent_data_cb readcb = NULL;
+    void *ctx = NULL;
+    bufferevent_getcb(bev, &readcb, NULL, NULL, &ctx);
+    return readcb == conn_read_cb ? ctx : NULL;
+}
 
-    struct event_base *base = evconnlistener_get_base(listener);
+static void connection_free(Connection *conn) {
+    LOG_DEBUG("SERVER", "Closing connection (%d request(s) in flight)", conn->in_flight);
+    if (conn->current) {
+        if (conn->body_handler) {
+            conn->body_handler(conn->current, NULL, 0, true);
+        }
+        cweb_free_http_request(conn->current);
+    }
+    Exchange *ex = conn->head;
+    while (ex) {
+        Exchange *next = ex->next;
+        if (!ex->ready && ex->res->pending == ex) {
+            // Still owned by an async handler, released once it completes
+            server_orphan_exchange(ex);
+        } else {
+            server_cache_abandon(ex->req);
+            cweb_free_http_response(ex->res);
+            cweb_free_http_request(ex->req);
+            cweb_leak_tracker_record("exchange", ex, sizeof(*ex), false);
+            free(ex);
+        }
+        ex = next;
+    }
+    if (conn->h2) {
+        server_h2_free(conn);
+    }
+    if (conn->header_timer) {
+        event_free(conn->header_timer);
+    }
+    // Lets the io_uring side of a pair send what is left and close the socket
+    struct bufferevent *transport = bufferevent_get_underlying(conn->bev);
+    bufferevent_flush(transport ? transport : conn->bev, EV_WRITE, BEV_FINISHED);
+    cweb_leak_tracker_record("bufferevent", conn->bev, 0, false);
+    bufferevent_free(conn->bev);
+    cweb_leak_tracker_record("connection", conn, sizeof(*conn), false);
+    free(conn);
+    server_release_connection();
+}
 
-    // Create a buffered event to manage the connection
-    struct bufferevent *bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE);
-    if (!bev) {
-        fprintf(stderr, "Error constructing bufferevent for new connection\n");
-        close(fd); // Schließe den Socket, um Ressourcen freizugeben
-        return;
+// Read timeout depends on what the connection is doing: a started request
+// gets read_timeout, an idle one keep_alive_timeout, and none applies while
+// a handler is busy or responses are still being written (write_timeout
+// covers those), so slow handlers and slow readers are not cut off.
+static void connection_update_timeout(Connection *conn) {
+    int read_secs = 0;
+    if (conn->state == CONN_READING_HEADERS || conn->state == CONN_READING_BODY) {
+        read_secs = server_settings.read_timeout;
+    } else if (conn->state == CONN_IDLE && conn->in_flight == 0 && !server_h2_busy(conn) &&
+               evbuffer_get_length(bufferevent_get_output(conn->bev)) == 0) {
+        read_secs = server_settings.keep_alive_timeout > 0 ? server_settings.keep_alive_timeout
+                                                           : server_settings.read_timeout;
     }
-    cweb_leak_tracker_record("bufferevent", bev, 0, true);
+    struct timeval read_tv = { read_secs, 0 };
+    struct timeval write_tv = { server_settings.write_timeout, 0 };
+    bufferevent_set_timeouts(conn->bev, read_secs > 0 ? &read_tv : NULL,
+                             server_settings.write_timeout > 0 ? &write_tv : NULL);
+}
 
-    // Set the callbacks for read and event events (like disconnect)
-    bufferevent_setcb(bev, conn_read_cb, NULL, conn_event_cb, NULL);
-    bufferevent_enable(bev, EV_READ | EV_WRITE);
+// Stop reading and close as soon as everything queued has been written.
+static void connection_finish(Connection *conn) {
+    conn->state = CONN_CLOSING;
+    bufferevent_disable(conn->bev, EV_READ);
+    evbuffer_drain(bufferevent_get_input(conn->bev), evbuffer_get_length(bufferevent_get_input(conn->bev)));
 }
 
-// This callback is executed when there is data to read on a connection.
-static void conn_read_cb(struct bufferevent *bev, void *ctx) {
-// todo überarbeitne
-    (void)ctx; // Unbenutzter Parameter
-
-    struct evbuffer *input = bufferevent_get_input(bev);
-    size_t len = evbuffer_get_length(input);
-    LOG_DEBUG("SERVER", "Received %zu bytes of data", len);
-    if (len == 0) return;
-
-    // Read the data from the buffer into a C string
-    AUTOFREE char *data = malloc(len + 1);
-    if (!data) {
-        fprintf(stderr, "Memory allocation failed\n");
+// A response could not be queued whole, or not even allocated: the stream is
+// out of step, so what is already in the output goes out and then the
+// connection is closed. The triggered write callback frees it even when
+// nothing is left to write.
+static void connection_write_failed(Connection *conn) {
+    conn->write_failed = true;
+    connection_finish(conn);
+    bufferevent_trigger(conn->bev, EV_WRITE, BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+}
+
+// HTTP/2 session is over (GOAWAY either way). Its last frames may already be
+// written, so the write callback that frees the connection is run by hand.
+static void connection_h2_done(Connection *conn) {
+    connection_finish(conn);
+    bufferevent_trigger(conn->bev, EV_WRITE, BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+}
+
+static bool header_has_token(const char *value, const char *token) {
+    if (!value) return false;
+    size_t token_len = strlen(token);
+    const char *p = value;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *start = p;
+        while (*p && *p != ',') p++;
+        const char *end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+        if ((size_t)(end - start) == token_len && strncasecmp(start, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// HTTP/1.1 is persistent unless the client says otherwise, HTTP/1.0 only on request
+static bool request_wants_keep_alive(const Request *req) {
+    const char *connection = cweb_get_request_header_id(req, CWEB_HEADER_CONNECTION);
+    if (strcmp(req->version, "HTTP/1.1") == 0) {
+        return !header_has_token(connection, "close");
+    }
+    if (strcmp(req->version, "HTTP/1.0") == 0) {
+        return header_has_token(connection, "keep-alive");
+    }
+    return false;
+}
+
+
+static Exchange *connection_push(Connection *conn, Request *req, Response *res) {
+    Exchange *ex = calloc(1, sizeof(Exchange));
+    if (!ex) return NULL;
+    cweb_leak_tracker_record("exchange", ex, sizeof(*ex), true);
+    ex->req = req;
+    ex->res = res;
+    ex->conn = conn;
+    if (conn->tail) {
+        conn->tail->next = ex;
+    } else {
+        conn->head = ex;
+    }
+    conn->tail = ex;
+    conn->in_flight++;
+    connection_update_timeout(conn);
+    return ex;
+}
+
+// Answer a request that never reached a handler (malformed, too large, ...)
+static void connection_reject(Connection *conn, int status_code) {
+    LOG_DEBUG("SERVER", "Rejecting request with %d", status_code);
+    Request *req = cweb_create_request();
+    Response *res = cweb_create_response_for(req);
+    if (!req || !res) {
+        cweb_free_http_response(res);
+        cweb_free_http_request(req);
+        connection_write_failed(conn);
         return;
     }
-    cweb_leak_tracker_record("server.data", data, len + 1, true);
-    evbuffer_remove(input, data, len);
-    data[len] = '\0';
+    res->status_code = status_code;
+    res->body = strdup(cweb_get_status_message(status_code));
+    res->body_len = res->body ? strlen(res->body) : 0;
+    if (res->body) cweb_leak_tracker_record(" res->body ", res->body, res->body_len, true);
+    cweb_add_response_header(res, "Content-Type", "text/plain");
+    res->state = PROCESSED;
 
-    Request *req = cweb_parse_request(data, len);
-    if (!req) {
-        fprintf(stderr, "Failed to parse request\n");
-        return; // Kein Speicher wurde bisher allokiert, daher kein `free` nötig
+    Exchange *ex = connection_push(conn, req, res);
+    if (!ex) {
+        cweb_free_http_response(res);
+        cweb_free_http_request(req);
+        connection_write_failed(conn);
+        return;
     }
-    if (!req) return; // Bad request
+    ex->close_after = true;
+    connection_finish(conn);
+    cweb_send_response(conn->bev, req, res);
+}
 
+static void connection_dispatch(Connection *conn, Request *req, int32_t stream_id) {
 	cweb_speedbench_start(req, req->path);
 
-    const char* old_session_id = req->session_id;
+    // The route decides whether the session cookie is looked at at all
+    const Route *route = cweb_match_route(req);
+    route_handler_t handler = route ? cweb_route_handler(route, req) : cweb_get_fallback_handler();
+    req->using_session = route && route->using_session;
+    LOG_DEBUG("REQ session bool", "Using session for request: %s", req->using_session ? "true" : "false");
+
+    char old_session_id[SESSION_ID_LEN + 1] = "";
     if (req->using_session) {
-        LOG_DEBUG("SESSION", "Session associated with request: %s", req->session ? req->session->id : "NULL");
-        req->session = get_or_create_session(old_session_id);
+        const char *cookie;
+        size_t cookie_len;
+        if (cweb_get_cookie(req, "session_id", &cookie, &cookie_len) && cookie_len <= SESSION_ID_LEN) {
+            memcpy(old_session_id, cookie, cookie_len);
+            old_session_id[cookie_len] = '\0';
+        }
+        req->session = get_or_create_session(old_session_id[0] ? old_session_id : NULL);
 
         // Aktualisiere req->session_id mit der neuen Session-ID
         if (req->session) {
-            if (req->session_id) {
-                free(req->session_id); // Alte session_id freigeben
-            }
-            req->session_id = strdup(req->session->id);
+            req->session_id = cweb_request_strdup(req, req->session->id);
             LOG_DEBUG("SESSION", "Updated session_id: %s", req->session_id);
         }
         LOG_DEBUG("SESSION", "2 Session associated with request: %s", req->session ? req->session->id : "NULL");
     }
     
-    Response *res = cweb_create_response();
+    Response *res = cweb_create_response_for(req);
     if (!res) {
         fprintf(stderr, "Failed to create response\n");
         cweb_free_http_request(req);
+        connection_reject(conn, 500);
         return;
     }
     res->status_code = 404; // Default to 404
 
-    // If a new session was created, set the cookie in the response
-    if (req->session && (!old_session_id || strcmp(old_session_id, req->session->id) != 0)) {
-        AUTOFREE char* cookie_val = NULL;
-        if (asprintf(&cookie_val, "session_id=%s; HttpOnly; Path=/; Max-Age=%d", req->session->id, SESSION_LIFETIME) < 0) {
-            LOG_ERROR("SET_COOKIE", "Failed to allocate session cookie for %s", req->session->id);
-        } else {
-            cweb_add_response_header(res, "Set-Cookie", cookie_val);
-            LOG_DEBUG("SET_COOKIE", "Set-Cookie header added: %s", cookie_val);
-        }
+    Exchange *ex = connection_push(conn, req, res);
+    if (!ex) {
+        cweb_free_http_response(res);
+        cweb_free_http_request(req);
+        connection_write_failed(conn);
+        return;
+    }
+    ex->stream_id = stream_id;
+    if (!conn->h2 && (!server_settings.keep_alive_timeout || !request_wants_keep_alive(req))) {
+        ex->close_after = true;
+        connection_finish(conn);
     }
 
-    route_handler_t handler = cweb_get_route_handler(req->path, &req->using_session);
-    LOG_DEBUG("REQ session bool", "Using session for request: %s", req->using_session ? "true" : "false");
+    // If a new session was created, set the cookie in the response
+    if (req->session && strcmp(old_session_id, req->session->id) != 0) {
+        char cookie_val[SESSION_ID_LEN + 64];
+        snprintf(cookie_val, sizeof(cookie_val), "session_id=%s; HttpOnly; Path=/; Max-Age=%d", req->session->id, SESSION_LIFETIME);
+        cweb_add_response_header(res, "Set-Cookie", cookie_val);
+        LOG_DEBUG("SET_COOKIE", "Set-Cookie header added: %s", cookie_val);
+    }
 
-    if (handler) {
+    // A hit is answered right away, a waiter once the request rendering it is done
+    CacheLookup cached = route && handler ? server_cache_lookup(route, req, res) : CACHE_MISS;
+    if (cached == CACHE_HIT || cached == CACHE_WAIT) {
+        LOG_DEBUG("ROUTING", "Route cache %s for path: %s", cached == CACHE_HIT ? "hit" : "wait", req->path);
+    } else if (handler) {
         LOG_DEBUG("ROUTING", "Found handler for path: %s", req->path);
         handler(req, res);
     } else if (cweb_fileserver_is_static_file(req->path) == true) {
@@ -186,13 +513,470 @@ static void conn_read_cb(struct bufferevent *bev, void *ctx) {
     }
 
     if (res->state == PROCESSED) {
-        cweb_send_response(bev, req, res);
+        cweb_send_response(conn->bev, req, res);
     } else {
-        cweb_add_pending_response(req, res, bev);
+        cweb_add_pending_response(req, res, conn->bev);
         LOG_DEBUG("SERVER", "Response pending, added to async queue");
     }
 }
 
+// Hand a piece of body to the streaming handler or append it to req->body.
+static bool connection_body_data(Connection *conn, const char *data, size_t len) {
+    Request *req = conn->current;
+    if (len == 0) return true;
+    if (conn->body_handler) {
+        req->body_len += len;
+        conn->body_handler(req, data, len, false);
+        return true;
+    }
+    return server_buffer_body(req, data, len);
+}
+
+bool server_buffer_body(Request *req, const char *data, size_t len) {
+    if (len > server_settings.max_body_size - req->body_len) {
+        return false;
+    }
+    char *body = realloc(req->body, req->body_len + len + 1);
+    if (!body) return false;
+    if (req->body) cweb_leak_tracker_record("req.body", req->body, 0, false);
+    cweb_leak_tracker_record("req.body", body, req->body_len + len + 1, true);
+    memcpy(body + req->body_len, data, len);
+    req->body = body;
+    req->body_len += len;
+    req->body[req->body_len] = '\0';
+    return true;
+}
+
+// Pass up to max bytes straight out of the input buffer, segment by segment.
+static bool connection_consume_body(Connection *conn, struct evbuffer *input, size_t max, size_t *consumed) {
+    *consumed = 0;
+    while (*consumed < max) {
+        struct evbuffer_iovec vec;
+        if (evbuffer_peek(input, -1, NULL, &vec, 1) < 1 || vec.iov_len == 0) break;
+        size_t n = vec.iov_len < max - *consumed ? vec.iov_len : max - *consumed;
+        if (!connection_body_data(conn, vec.iov_base, n)) return false;
+        evbuffer_drain(input, n);
+        *consumed += n;
+    }
+    return true;
+}
+
+// Parse a chunk-size line ("1a2f;ext=1"), false on anything but hex digits first
+static bool parse_chunk_size(const char *line, size_t *size) {
+    size_t value = 0;
+    const char *p = line;
+    for (; isxdigit((unsigned char)*p); p++) {
+        if (value > (SIZE_MAX >> 4)) return false;
+        value = (value << 4) | (size_t)(isdigit((unsigned char)*p) ? *p - '0' : (tolower((unsigned char)*p) - 'a' + 10));
+    }
+    if (p == line) return false;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p != '\0' && *p != ';') return false;
+    *size = value;
+    return true;
+}
+
+// Read as much of the current body as is buffered.
+// Returns 1 when the body is complete, 0 when more data is needed and
+// a status code (400, 413) when the request has to be rejected.
+static int connection_read_body(Connection *conn) {
+    struct evbuffer *input = bufferevent_get_input(conn->bev);
+
+    if (conn->framing == BODY_LENGTH) {
+        size_t consumed = 0;
+        if (!connection_consume_body(conn, input, conn->body_remaining, &consumed)) return 413;
+        conn->body_remaining -= consumed;
+        return conn->body_remaining == 0 ? 1 : 0;
+    }
+
+    for (;;) {
+        if (conn->chunk_state == CHUNK_DATA) {
+            size_t consumed = 0;
+            if (!connection_consume_body(conn, input, conn->body_remaining, &consumed)) return 413;
+            conn->body_remaining -= consumed;
+            if (conn->body_remaining > 0) return 0;
+            conn->chunk_state = CHUNK_DATA_END;
+        }
+
+        if (conn->chunk_state == CHUNK_DATA_END) {
+            char crlf[2];
+            if (evbuffer_copyout(input, crlf, 2) < 2) return 0;
+            if (crlf[0] != '\r' || crlf[1] != '\n') return 400;
+            evbuffer_drain(input, 2);
+            conn->chunk_state = CHUNK_SIZE;
+            continue;
+        }
+
+        // Size and trailer lines
+        size_t line_len = 0;
+        AUTOFREE char *line = evbuffer_readln(input, &line_len, EVBUFFER_EOL_CRLF_STRICT);
+        if (!line) {
+            return evbuffer_get_length(input) > MAX_CHUNK_LINE_SIZE ? 400 : 0;
+        }
+        if (line_len > MAX_CHUNK_LINE_SIZE) return 400;
+
+        if (conn->chunk_state == CHUNK_TRAILER) {
+            if (line_len == 0) return 1; // End of trailers, trailer fields are ignored
+            continue;
+        }
+
+        size_t size = 0;
+        if (!parse_chunk_size(line, &size)) return 400;
+        if (size == 0) {
+            conn->chunk_state = CHUNK_TRAILER;
+        } else {
+            conn->chunk_state = CHUNK_DATA;
+            conn->body_remaining = size;
+        }
+    }
+}
+
+// Work out how the body of req is framed. Returns 0 when there is no body,
+// 1 when a body follows and a status code when the framing is invalid.
+static int connection_begin_body(Connection *conn, Request *req) {
+    const char *transfer_encoding = cweb_get_request_header_id(req, CWEB_HEADER_TRANSFER_ENCODING);
+    const char *content_length = cweb_get_request_header_id(req, CWEB_HEADER_CONTENT_LENGTH);
+
+    const Route *route = cweb_match_route(req);
+    conn->body_handler = route ? route->body_handler : NULL;
+
+    if (transfer_encoding) {
+        // Both headers at once is a smuggling vector, and no coding other
+        // than plain chunked is decoded, so "gzip, chunked" is refused too
+        if (content_length) return 400;
+        if (strcasecmp(transfer_encoding, "chunked") != 0) return 501;
+        conn->framing = BODY_CHUNKED;
+        conn->chunk_state = CHUNK_SIZE;
+        conn->body_remaining = 0;
+    } else if (content_length) {
+        const char *p = content_length;
+        size_t value = 0;
+        for (; isdigit((unsigned char)*p); p++) {
+            if (value > (SIZE_MAX - 9) / 10) return 413;
+            value = value * 10 + (size_t)(*p - '0');
+        }
+        if (p == content_length || *p != '\0') return 400;
+        if (value == 0) return 0;
+        if (!conn->body_handler && value > server_settings.max_body_size) return 413;
+        conn->framing = BODY_LENGTH;
+        conn->body_remaining = value;
+    } else {
+        return 0;
+    }
+
+    const char *expect = cweb_get_request_header_id(req, CWEB_HEADER_EXPECT);
+    conn->send_continue = expect && strcasecmp(expect, "100-continue") == 0
+                          && strcmp(req->version, "HTTP/1.1") == 0;
+    return 1;
+}
+
+// Body is complete (or failed with status): hand the request on.
+static void connection_end_body(Connection *conn, int status) {
+    Request *req = conn->current;
+    conn->current = NULL;
+    conn->send_continue = false;
+    if (conn->body_handler) {
+        conn->body_handler(req, NULL, 0, true);
+    }
+    conn->body_handler = NULL;
+
+    if (status != 1) {
+        cweb_free_http_request(req);
+        connection_reject(conn, status);
+        return;
+    }
+    // Idle again, so the next head arms header_timer for its own deadline
+    conn->state = CONN_IDLE;
+    connection_dispatch(conn, req, 0);
+}
+
+void server_dispatch(Connection *conn, Request *req, int32_t stream_id) {
+    connection_dispatch(conn, req, stream_id);
+}
+
+void server_cancel_stream(Connection *conn, int32_t stream_id) {
+    Exchange **link = &conn->head;
+    Exchange *last = NULL;
+    while (*link && (*link)->stream_id != stream_id) {
+        last = *link;
+        link = &(*link)->next;
+    }
+    Exchange *ex = *link;
+    if (!ex) return;
+    *link = ex->next;
+    if (conn->tail == ex) conn->tail = last;
+    conn->in_flight--;
+
+    if (ex->res->pending == ex) {
+        server_orphan_exchange(ex); // Async handler still holds the response
+    } else {
+        server_cache_abandon(ex->req);
+        cweb_free_http_response(ex->res);
+        cweb_free_http_request(ex->req);
+        cweb_leak_tracker_record("exchange", ex, sizeof(*ex), false);
+        free(ex);
+    }
+}
+
+// Frame and dispatch every complete request in the input buffer.
+static void connection_process_input(Connection *conn) {
+    if (conn->processing) return;
+    conn->processing = true;
+
+    struct evbuffer *input = bufferevent_get_input(conn->bev);
+    while (conn->state != CONN_CLOSING) {
+        if (conn->h2) {
+            if (!server_h2_input(conn)) {
+                connection_h2_done(conn);
+            }
+            break;
+        }
+        if (conn->state == CONN_READING_BODY) {
+            // Interim response only once everything before it has been answered
+            if (conn->send_continue && conn->in_flight == 0) {
+                conn->send_continue = false;
+                bufferevent_write(conn->bev, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+            }
+            int status = connection_read_body(conn);
+            if (status == 0) break;
+            connection_end_body(conn, status);
+            continue;
+        }
+
+        // Stop reading while the pipeline is full, flush resumes it
+        if (conn->in_flight >= server_settings.max_pipelined_requests) {
+            bufferevent_disable(conn->bev, EV_READ);
+            break;
+        }
+
+        // Client is not reading its responses: take no new requests until it does
+        if (server_settings.output_high_watermark > 0 &&
+            evbuffer_get_length(bufferevent_get_output(conn->bev)) >= server_settings.output_high_watermark) {
+            conn->output_blocked = true;
+            bufferevent_disable(conn->bev, EV_READ);
+            break;
+        }
+
+        // Tolerate stray CRLFs between requests
+        unsigned char c;
+        while (evbuffer_copyout(input, &c, 1) == 1 && (c == '\r' || c == '\n')) {
+            evbuffer_drain(input, 1);
+        }
+
+        size_t len = evbuffer_get_length(input);
+        if (len == 0) {
+            conn->state = CONN_IDLE;
+            break;
+        }
+        // HTTP/2 with prior knowledge: the client opens with the connection preface
+        if (server_settings.http2 && conn->state != CONN_READING_HEADERS && conn->in_flight == 0) {
+            int preface = server_h2_detect(input);
+            if (preface < 0) break;
+            if (preface > 0) {
+                if (server_h2_start(conn, NULL) != 0) {
+                    connection_write_failed(conn);
+                    break;
+                }
+                continue;
+            }
+        }
+        if (conn->state != CONN_READING_HEADERS) {
+            // Slowloris: the whole head has to arrive within header_timeout
+            conn->state = CONN_READING_HEADERS;
+            conn->head_scanned = 0;
+            if (conn->header_timer) {
+                struct timeval deadline = { server_settings.header_timeout, 0 };
+                evtimer_add(conn->header_timer, &deadline);
+            }
+        }
+
+        // A head split over several reads is only searched from where the
+        // last read stopped (minus a possibly partial CRLFCRLF)
+        struct evbuffer_ptr from;
+        evbuffer_ptr_set(input, &from, conn->head_scanned, EVBUFFER_PTR_SET);
+        struct evbuffer_ptr end = evbuffer_search(input, "\r\n\r\n", 4, &from);
+        if (end.pos < 0) {
+            // Head still incomplete, wait for more data
+            if (len > server_settings.max_header_size) {
+                connection_reject(conn, 431);
+            }
+            conn->head_scanned = len > 3 ? len - 3 : 0;
+            break;
+        }
+        if (conn->header_timer) {
+            evtimer_del(conn->header_timer);
+        }
+        conn->head_scanned = 0;
+
+        size_t head_len = (size_t)end.pos + 4;
+        if (head_len > server_settings.max_header_size) {
+            connection_reject(conn, 431);
+            break;
+        }
+        LOG_DEBUG("SERVER", "Received request head of %zu bytes", head_len);
+
+        // One copy out of the input chain into the request arena (the pooled
+        // request already owns that block), then the head is parsed in place
+        Request *req = cweb_create_request();
+        char *head = req ? cweb_request_alloc(req, head_len) : NULL;
+        if (!head) {
+            cweb_free_http_request(req);
+            connection_reject(conn, 500);
+            break;
+        }
+        evbuffer_remove(input, head, head_len);
+        int status = cweb_parse_request_head(req, head, head_len);
+        if (status == 0 && req->path[0] != '/') status = 400;
+        if (status != 0) {
+            LOG_INFO("SERVER", "Rejecting malformed request head with %d", status);
+            cweb_free_http_request(req);
+            connection_reject(conn, status);
+            break;
+        }
+
+        int framing = connection_begin_body(conn, req);
+        if (framing == 0 && server_settings.http2 && conn->in_flight == 0 &&
+            server_h2_upgrade_requested(req) && server_h2_start(conn, req) == 0) {
+            conn->state = CONN_IDLE;
+            continue; // req is answered on stream 1
+        }
+        if (framing == 0) {
+            conn->state = CONN_IDLE;
+            connection_dispatch(conn, req, 0);
+        } else if (framing == 1) {
+            conn->current = req;
+            conn->state = CONN_READING_BODY;
+        } else {
+            cweb_free_http_request(req);
+            connection_reject(conn, framing);
+            break;
+        }
+    }
+
+    connection_update_timeout(conn);
+    conn->processing = false;
+}
+
+static void connection_header_timeout_cb(evutil_socket_t fd, short events, void *ctx) {
+    (void)fd;
+    (void)events;
+    Connection *conn = ctx;
+    if (conn->state != CONN_READING_HEADERS) return;
+    LOG_INFO("SERVER", "Request head not complete after %ds, closing", server_settings.header_timeout);
+    connection_reject(conn, 408);
+}
+
+bool server_admit_connection(evutil_socket_t fd, const char *peer) {
+    int open_connections = atomic_fetch_add(&active_connections, 1);
+    if (server_settings.max_connections > 0 && open_connections >= server_settings.max_connections) {
+        atomic_fetch_sub(&active_connections, 1);
+        LOG_WARNING("SERVER", "Connection limit of %d reached, dropping %s", server_settings.max_connections, peer);
+        return false;
+    }
+    // Responses go out in pieces (head, body, 16K writes): without this the
+    // last piece waits for the client's delayed ACK
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return true;
+}
+
+void server_release_connection(void) {
+    atomic_fetch_sub(&active_connections, 1);
+}
+
+Connection *server_open_connection(struct event_base *base, struct bufferevent *bev) {
+    cweb_leak_tracker_record("bufferevent", bev, 0, true);
+    Connection *conn = calloc(1, sizeof(Connection));
+    if (!conn) {
+        fprintf(stderr, "Error allocating connection state\n");
+        cweb_leak_tracker_record("bufferevent", bev, 0, false);
+        bufferevent_free(bev);
+        server_release_connection();
+        return NULL;
+    }
+    cweb_leak_tracker_record("connection", conn, sizeof(*conn), true);
+    conn->bev = bev;
+    conn->state = CONN_IDLE;
+    if (server_settings.header_timeout > 0) {
+        conn->header_timer = evtimer_new(base, connection_header_timeout_cb, conn);
+    }
+
+    // Set the callbacks for read, write and event events (like disconnect)
+    bufferevent_setcb(bev, conn_read_cb, conn_write_cb, conn_event_cb, conn);
+    // Write callback fires once output is back under half the high watermark
+    bufferevent_setwatermark(bev, EV_WRITE, server_settings.output_high_watermark / 2, 0);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    connection_update_timeout(conn);
+    return conn;
+}
+
+// This callback is executed when a new TCP connection is accepted.
+static void listener_cb(struct evconnlistener *listener, evutil_socket_t fd,
+                        struct sockaddr *addr, int socklen, void *ctx) {
+
+    (void)ctx;
+    (void)socklen;
+
+    struct sockaddr_in *sin = (struct sockaddr_in*)addr;
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &sin->sin_addr, ip, sizeof(ip));
+    LOG_INFO("SERVER", "New connection from %s:%d", ip, ntohs(sin->sin_port));
+
+    if (!server_admit_connection(fd, ip)) {
+        close(fd);
+        return;
+    }
+
+    // Create a buffered event to manage the connection
+    struct event_base *base = evconnlistener_get_base(listener);
+    struct bufferevent *bev = server_tls_enabled()
+        ? server_tls_accept(base, fd, NULL)
+        : bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        fprintf(stderr, "Error constructing bufferevent for new connection\n");
+        server_release_connection();
+        close(fd); // Schließe den Socket, um Ressourcen freizugeben
+        return;
+    }
+    server_open_connection(base, bev);
+}
+
+// This callback is executed when there is data to read on a connection.
+static void conn_read_cb(struct bufferevent *bev, void *ctx) {
+    (void)bev;
+    connection_process_input(ctx);
+}
+
+// Output buffer drained: a closing connection can go away now, a blocked
+// one may take requests again.
+static void conn_write_cb(struct bufferevent *bev, void *ctx) {
+    Connection *conn = ctx;
+    if (conn->state == CONN_CLOSING) {
+        if ((!conn->head || conn->write_failed) && evbuffer_get_length(bufferevent_get_output(bev)) == 0) {
+            connection_free(conn);
+        }
+        return;
+    }
+    if (conn->h2) {
+        // Room in the output again for frames the session held back
+        if (!server_h2_send(conn)) {
+            connection_h2_done(conn);
+        }
+        connection_update_timeout(conn);
+        return;
+    }
+    if (evbuffer_get_length(bufferevent_get_output(bev)) == 0) {
+        connection_update_timeout(conn); // Idle from here on
+    }
+    if (conn->output_blocked) {
+        conn->output_blocked = false;
+        if (conn->in_flight < server_settings.max_pipelined_requests) {
+            bufferevent_enable(bev, EV_READ);
+            connection_process_input(conn);
+        }
+    }
+}
+
 static int path_is_compressible(const char *path) {
     if (!path) return 0;
     const char *dot = strrchr(path, '.');
@@ -212,80 +996,215 @@ static int path_is_compressible(const char *path) {
     return 0;
 }
 
-void cweb_send_response(struct bufferevent *bev, Request *req, Response *res) {
-    if (!bev || !req || !res) {
-        LOG_ERROR("SEND_RESPONSE", "Invalid args (bev=%p req=%p res=%p)", (void*)bev, (void*)req, (void*)res);
-        return;
-    }
-    if (res->state != PROCESSED) {
-        LOG_DEBUG("SEND_RESPONSE", "Response not ready");
-        return;
-    }
+// Releases a response body once libevent has written it out
+static void release_response_body(const void *data, size_t datalen, void *extra) {
+    (void)datalen;
+    (void)extra;
+    cweb_leak_tracker_record("res.body", (void *)data, 0, false);
+    free((void *)data);
+}
 
+// Drops the output buffer's reference to a stored response
+static void release_shared_body(const void *data, size_t datalen, void *extra) {
+    (void)data;
+    (void)datalen;
+    cweb_shared_body_release(extra);
+}
 
-	/* testing compression options for eacha lone */
-	// char *out = NULL;
-	// size_t out_len = 0;
-	
-	// cweb_brotli(res->body, res->body_len, &out, &out_len);
-	// cweb_gzip(res->body, res->body_len, &out, &out_len);
-	// free(res->body);
-	// res->body = out;
-	// res->body_len = out_len;
-	// cweb_add_response_header(res, "Content-Encoding", "gzip");
-	// cweb_add_response_header(res, "Vary", "Accept-Encoding");
-	
-	int do_compress = path_is_compressible(req->path) && res->body && res->body_len > 512;
+// Write a completed response to the connection and release it.
+// Only the head is copied, the body is handed to the output buffer by reference.
+void server_prepare_response(Request *req, Response *res) {
+	// A header block comes with its final body (see Response.header_block).
+	// HEAD is compressed like GET so its head matches, write_response drops the body
+	int do_compress = !res->header_block &&
+	                  path_is_compressible(req->path) && res->body && res->body_len > 512;
 
     // App-Benchmark hier beenden (ohne Kompression/Serialisierung)
 
 
     // Optional: Kompression (auto_compress sollte Accept-Encoding prüfen)
     if (do_compress) {
-        struct timespec c0, c1; clock_gettime(CLOCK_MONOTONIC, &c0);
         LOG_DEBUG("SEND_RESPONSE", "auto_compress %s (%zu bytes)", req->path, res->body_len);
         cweb_auto_compress(req, res); // intern: gzip lvl 3–5 oder brotli q≈4–5
-        clock_gettime(CLOCK_MONOTONIC, &c1);
-        double cms = (c1.tv_sec - c0.tv_sec)*1000.0 + (c1.tv_nsec - c0.tv_nsec)/1e6;
-        LOG_WARNING("SEND_RESPONSE", "compress_dur=%.2fms after=%zu bytes", cms, res->body_len);
-    } else {
-        LOG_WARNING("SEND_RESPONSE", "skip compress %s (%zu bytes)", req->path, res->body_len);
+        LOG_DEBUG("SEND_RESPONSE", "compressed %s to %zu bytes", req->path, res->body_len);
     }
 
-    size_t response_len = 0;
-    AUTOFREE char *response_str = cweb_serialize_response(res, &response_len);
-    if (!response_str) {
-        LOG_ERROR("SEND_RESPONSE", "serialize_response failed");
-        cweb_free_http_response(res);
-        cweb_free_http_request(req);
-        return;
+    // Final bytes, the route cache keeps them for the next requests
+    server_cache_fill(req, res);
+}
+
+int server_response_body(Response *res, struct evbuffer *out) {
+    if (res->body_file) {
+        // File segment, written with sendfile
+        if (evbuffer_add_buffer(out, res->body_file) != 0) {
+            LOG_ERROR("SEND_RESPONSE", "evbuffer_add_buffer failed");
+            return -1;
+        }
+    } else if (res->shared && res->body == res->shared->body && res->body_len > 0) {
+        // Stored in the route cache, which may drop it before this is written
+        cweb_shared_body_retain(res->shared);
+        if (evbuffer_add_reference(out, res->body, res->body_len, release_shared_body, res->shared) != 0) {
+            cweb_shared_body_release(res->shared);
+            LOG_ERROR("SEND_RESPONSE", "evbuffer_add_reference failed");
+            return -1;
+        }
+    } else if (res->body && res->body_len > 0) {
+        // Literal bodies outlive the response, owned ones are released by libevent
+        int rc = res->isliteral
+            ? evbuffer_add_reference(out, res->body, res->body_len, NULL, NULL)
+            : evbuffer_add_reference(out, res->body, res->body_len, release_response_body, NULL);
+        if (rc != 0) {
+            LOG_ERROR("SEND_RESPONSE", "evbuffer_add_reference failed");
+            return -1;
+        }
+        if (!res->isliteral) {
+            res->body = NULL; // Ownership moved to the output buffer
+        }
+    }
+    return 0;
+}
+
+// Returns -1 when the response could not be queued, the connection has to
+// be closed then.
+static int write_response(struct bufferevent *bev, Request *req, Response *res, bool close_after) {
+    server_prepare_response(req, res);
+
+    if (close_after) {
+        cweb_add_response_header(res, "Connection", "close");
+    } else if (strcmp(req->version, "HTTP/1.0") == 0) {
+        cweb_add_response_header(res, "Connection", "keep-alive");
     }
 
 	cweb_speedbench_end(req);
-   
-    if (bufferevent_write(bev, response_str, response_len) != 0) {
-        LOG_ERROR("SEND_RESPONSE", "bufferevent_write failed");
+
+    // The head is serialized straight into the output buffer
+    struct evbuffer *output = bufferevent_get_output(bev);
+    size_t head_len = cweb_response_head_length(res);
+    struct evbuffer_iovec iov;
+    int rc = -1;
+    if (evbuffer_reserve_space(output, (ev_ssize_t)head_len, &iov, 1) != 1) {
+        LOG_ERROR("SEND_RESPONSE", "evbuffer_reserve_space failed");
+    } else {
+        iov.iov_len = cweb_write_response_head(res, iov.iov_base);
+        if (evbuffer_commit_space(output, &iov, 1) != 0) {
+            LOG_ERROR("SEND_RESPONSE", "evbuffer_commit_space failed");
+        } else if (req->method_id != CWEB_METHOD_HEAD) {
+            rc = server_response_body(res, output); // HEAD: same head, the body is dropped with res
+        } else {
+            rc = 0;
+        }
     }
 
-    LOG_DEBUG("SERVER", "Sent response %d (%zu bytes body)", res->status_code, res->body_len);
+    if (rc == 0) {
+        LOG_DEBUG("SERVER", "Sent response %d (%zu bytes body)", res->status_code, res->body_len);
+    }
 
     cweb_free_http_response(res);
     cweb_free_http_request(req);
     cweb_leak_tracker_dump();
+    return rc;
+}
+
+// Write every response at the head of the queue that is ready, keeping
+// pipelined responses in request order.
+static void connection_flush(Connection *conn) {
+    if (conn->h2) {
+        // Streams are independent, every ready response goes out right away
+        Exchange **link = &conn->head;
+        Exchange *last = NULL;
+        while (*link) {
+            Exchange *ex = *link;
+            if (!ex->ready) {
+                last = ex;
+                link = &ex->next;
+                continue;
+            }
+            *link = ex->next;
+            conn->in_flight--;
+            server_h2_respond(conn, ex);
+            cweb_leak_tracker_record("exchange", ex, sizeof(*ex), false);
+            free(ex);
+        }
+        conn->tail = last;
+        if (conn->state != CONN_CLOSING && !server_h2_send(conn)) {
+            connection_h2_done(conn);
+        }
+        connection_update_timeout(conn);
+        return;
+    }
+
+    while (conn->head && conn->head->ready && !conn->write_failed) {
+        Exchange *ex = conn->head;
+        conn->head = ex->next;
+        if (!conn->head) conn->tail = NULL;
+        conn->in_flight--;
+
+        if (write_response(conn->bev, ex->req, ex->res, ex->close_after) != 0) {
+            LOG_ERROR("SERVER", "Response could not be written, closing the connection");
+            connection_write_failed(conn);
+        }
+        cweb_leak_tracker_record("exchange", ex, sizeof(*ex), false);
+        free(ex);
+    }
+    connection_update_timeout(conn);
+
+    if (conn->state == CONN_CLOSING) {
+        return; // conn_write_cb frees the connection once output is drained
+    }
+    // Pipeline has room again: pick up requests that are already buffered
+    if (conn->in_flight < server_settings.max_pipelined_requests && !conn->output_blocked) {
+        bufferevent_enable(conn->bev, EV_READ);
+        connection_process_input(conn);
+    }
+}
+
+void cweb_send_response(struct bufferevent *bev, Request *req, Response *res) {
+    if (!bev || !req || !res) {
+        LOG_ERROR("SEND_RESPONSE", "Invalid args (bev=%p req=%p res=%p)", (void*)bev, (void*)req, (void*)res);
+        return;
+    }
+    if (res->state != PROCESSED) {
+        LOG_DEBUG("SEND_RESPONSE", "Response not ready");
+        return;
+    }
+
+    Connection *conn = server_connection_from_bev(bev);
+    Exchange *ex = conn ? conn->head : NULL;
+    while (ex && ex->res != res) {
+        ex = ex->next;
+    }
+    if (!ex) {
+        if (conn && conn->h2) {
+            LOG_ERROR("SEND_RESPONSE", "Response for %s has no HTTP/2 stream", req->path);
+            cweb_free_http_response(res);
+            cweb_free_http_request(req);
+            return;
+        }
+        // Not a pipelined exchange of ours, write it straight away
+        if (write_response(bev, req, res, false) != 0 && conn) {
+            LOG_ERROR("SERVER", "Response could not be written, closing the connection");
+            connection_write_failed(conn);
+        }
+        return;
+    }
+
+    ex->ready = true;
+    connection_flush(conn);
 }
 
 // This callback is executed when a connection is closed or an error occurs.
 static void conn_event_cb(struct bufferevent *bev, short events, void *ctx) {
+    Connection *conn = ctx;
 
-    (void)ctx; // Unbenutzter Parameter
-
-    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+    if (events & BEV_EVENT_CONNECTED) {
+        server_tls_connected(bev);
+        return;
+    }
+    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR | BEV_EVENT_TIMEOUT)) {
         // The bufferevent will be freed, and the underlying socket closed,
         // because we used the BEV_OPT_CLOSE_ON_FREE option.
-        LOG_INFO("SERVER", "Connection closed or error occurred");
-        cweb_cancel_pending_responses(bev);
-        cweb_leak_tracker_record("bufferevent", bev, 0, false);
-        bufferevent_free(bev);
+        LOG_INFO("SERVER", "Connection closed, timed out or error occurred (events 0x%x)", events);
+        connection_free(conn);
     }
 }
 
@@ -311,6 +1230,7 @@ int configure_fileserver(FileServerMode mode, size_t max_file_size, bool auto_re
 void cweb_cleanup_server() {
     LOG_INFO("SERVER", "CWeb server shutting down...");
     cweb_cleanup_pending_responses();
+    server_cache_cleanup();
     cweb_clear_routes();
     cweb_fileserver_destroy();
     session_store_destroy();
@@ -0,0 +1,497 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/server.h>
+#include <cweb/compress.h>
+#include <cweb/leak_detector.h>
+#include "server_internal.h"
+#include <event2/event.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Rendered responses of the routes set up with cweb_set_route_cache, shared
+// by all workers. A hit only sets a flag on its entry, so lookups get by
+// with the read lock; eviction gives flagged entries a second chance.
+typedef struct CacheEntry {
+    struct CacheEntry *chain;   // Next in the bucket
+    struct CacheEntry *newer;   // Insertion order, evicted from the oldest end
+    struct CacheEntry *older;
+    uint64_t hash;
+    CwebSharedBody *shared;
+    uint64_t fresh_until;       // Monotonic ms
+    uint64_t stale_until;
+    size_t size;                // Counted against response_cache_size
+    bool referenced;            // Hit since it was last passed over, changed atomically
+    bool refreshing;            // A request renders its successor, changed atomically
+    size_t key_len;
+    char key[];
+} CacheEntry;
+
+#define CACHE_MIN_BUCKETS 256
+
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static CacheEntry **buckets = NULL;
+static size_t bucket_count = 0;
+static size_t entry_count = 0;
+static size_t cache_bytes = 0;
+static CacheEntry *newest = NULL;
+static CacheEntry *oldest = NULL;
+
+// A request the leader of a flight is rendering the response for
+typedef struct CacheWaiter {
+    Request *req;
+    Response *res;
+    bool cancelled;             // Client went away, res is an orphan now
+    struct CacheWaiter *next;
+} CacheWaiter;
+
+// Identical requests in flight on one worker (misses of a cached route, or
+// any on a route with cweb_set_route_coalesce): the first runs the handler,
+// the others wait for its response. Workers cannot wake each other, so each
+// coalesces its own.
+typedef struct CacheFlight {
+    struct CacheFlight *next;
+    const Route *route;
+    uint64_t hash;
+    bool store;                 // Route is cached, not only coalesced
+    bool refresh;               // The entry is served stale meanwhile
+    bool leaderless;            // Leader went away, a waiter takes over
+    bool resolving;             // Leader is done, waiters are answered next
+    CwebSharedBody *shared;     // The leader's response, NULL = waiters run the handler
+    CacheWaiter *waiters;       // Oldest first
+    CacheWaiter **waiters_tail;
+    size_t key_len;
+    char key[];
+} CacheFlight;
+
+static CWEB_THREAD_LOCAL CacheFlight *flights = NULL;
+// Answers waiters outside of whatever finished their flight
+static CWEB_THREAD_LOCAL struct event *resolve_event = NULL;
+
+static uint64_t cache_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+// FNV-1a
+static uint64_t cache_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211u;
+    }
+    return h;
+}
+
+// Calls fn for every name in the comma separated list
+static void each_query_key(const char *list, void (*fn)(Request *, const char *, size_t, char **, size_t *),
+                           Request *req, char **out, size_t *len) {
+    char name[128];
+    for (const char *p = list; p && *p;) {
+        while (*p == ',' || *p == ' ') p++;
+        size_t n = strcspn(p, ", ");
+        if (n > 0 && n < sizeof(name)) {
+            memcpy(name, p, n);
+            name[n] = '\0';
+            fn(req, name, n, out, len);
+        }
+        p += n;
+    }
+}
+
+// name=value NUL, or name NUL when the query lacks it; only counts without out
+static void append_query_value(Request *req, const char *name, size_t name_len, char **out, size_t *len) {
+    const char *value = NULL;
+    size_t value_len = 0;
+    bool present = cweb_get_query(req, name, &value, &value_len);
+    size_t n = name_len + 1 + (present ? value_len + 1 : 0);
+    if (*out) {
+        char *p = *out + *len;
+        memcpy(p, name, name_len);
+        p += name_len;
+        if (present) {
+            *p++ = '=';
+            memcpy(p, value, value_len);
+            p += value_len;
+        }
+        *p = '\0';
+    }
+    *len += n;
+}
+
+// Path without the query NUL, the selected query parameters, the encoding.
+// HEAD is answered from what GET stored, the method is not part of it.
+static char *cache_key(const Route *route, Request *req, size_t *key_len) {
+    size_t path_len = strcspn(req->path, "?");
+    size_t len = path_len + 1;
+    char *key = NULL;
+    each_query_key(route->cache_query, append_query_value, req, &key, &len);
+    key = cweb_request_alloc(req, len + 1);
+    if (!key) return NULL;
+
+    memcpy(key, req->path, path_len);
+    key[path_len] = '\0';
+    len = path_len + 1;
+    each_query_key(route->cache_query, append_query_value, req, &key, &len);
+    key[len++] = (char)('0' + cweb_pick_compression(cweb_get_request_header_id(req, CWEB_HEADER_ACCEPT_ENCODING)));
+    *key_len = len;
+    return key;
+}
+
+static CacheEntry *cache_find(const char *key, size_t key_len, uint64_t hash) {
+    if (!buckets) return NULL;
+    for (CacheEntry *e = buckets[hash & (bucket_count - 1)]; e; e = e->chain) {
+        if (e->hash == hash && e->key_len == key_len && memcmp(e->key, key, key_len) == 0) return e;
+    }
+    return NULL;
+}
+
+// Write lock held
+static void cache_remove(CacheEntry *entry) {
+    CacheEntry **link = &buckets[entry->hash & (bucket_count - 1)];
+    while (*link != entry) link = &(*link)->chain;
+    *link = entry->chain;
+    if (entry->newer) entry->newer->older = entry->older; else newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer; else oldest = entry->newer;
+    entry_count--;
+    cache_bytes -= entry->size;
+    cweb_shared_body_release(entry->shared);
+    cweb_leak_tracker_record("cache_entry", entry, 0, false);
+    free(entry);
+}
+
+static void cache_push_newest(CacheEntry *entry) {
+    entry->older = newest;
+    entry->newer = NULL;
+    if (newest) newest->newer = entry; else oldest = entry;
+    newest = entry;
+}
+
+// Write lock held. Keeps the buckets at most as many as the entries.
+static void cache_grow(void) {
+    size_t count = bucket_count ? bucket_count * 2 : CACHE_MIN_BUCKETS;
+    CacheEntry **grown = calloc(count, sizeof(*grown));
+    if (!grown) return; // Longer chains, still correct
+    for (size_t i = 0; i < bucket_count; i++) {
+        CacheEntry *e = buckets[i];
+        while (e) {
+            CacheEntry *next = e->chain;
+            e->chain = grown[e->hash & (count - 1)];
+            grown[e->hash & (count - 1)] = e;
+            e = next;
+        }
+    }
+    free(buckets);
+    buckets = grown;
+    bucket_count = count;
+}
+
+// Replaces the entry of flight's key, evicting until shared fits the budget
+static bool cache_store(const CacheFlight *flight, CwebSharedBody *shared) {
+    size_t budget = server_response_cache_size();
+    size_t size = sizeof(CacheEntry) + flight->key_len + sizeof(*shared) + shared->body_len + shared->headers->len;
+    if (size > budget) return false;
+    CacheEntry *entry = malloc(sizeof(CacheEntry) + flight->key_len);
+    if (!entry) return false;
+    cweb_leak_tracker_record("cache_entry", entry, sizeof(CacheEntry) + flight->key_len, true);
+    memset(entry, 0, sizeof(*entry));
+    entry->hash = flight->hash;
+    entry->key_len = flight->key_len;
+    memcpy(entry->key, flight->key, flight->key_len);
+    entry->size = size;
+    entry->shared = shared;
+    cweb_shared_body_retain(shared);
+    uint64_t now = cache_now();
+    entry->fresh_until = now + (uint64_t)flight->route->cache_ttl * 1000u;
+    entry->stale_until = entry->fresh_until + (uint64_t)flight->route->cache_stale * 1000u;
+
+    pthread_rwlock_wrlock(&cache_lock);
+    CacheEntry *old = cache_find(flight->key, flight->key_len, flight->hash);
+    if (old) cache_remove(old);
+    while (oldest && cache_bytes + size > budget) {
+        CacheEntry *victim = oldest;
+        if (__atomic_exchange_n(&victim->referenced, false, __ATOMIC_RELAXED) && victim->stale_until > now) {
+            // Second chance
+            oldest = victim->newer;
+            if (oldest) oldest->older = NULL; else newest = NULL;
+            cache_push_newest(victim);
+            continue;
+        }
+        cache_remove(victim);
+    }
+    if (entry_count >= bucket_count) cache_grow();
+    if (buckets) {
+        CacheEntry **bucket = &buckets[entry->hash & (bucket_count - 1)];
+        entry->chain = *bucket;
+        *bucket = entry;
+        cache_push_newest(entry);
+        entry_count++;
+        cache_bytes += size;
+        entry = NULL;
+    }
+    pthread_rwlock_unlock(&cache_lock);
+
+    if (!entry) return true;
+    cweb_shared_body_release(entry->shared);
+    cweb_leak_tracker_record("cache_entry", entry, 0, false);
+    free(entry);
+    return false;
+}
+
+// A body of its own, meant for everyone asking the same
+static bool response_shareable(const Response *res) {
+    if (res->body_file || res->header_block) return false;
+    if (cweb_get_response_header_id(res, CWEB_HEADER_SET_COOKIE)) return false;
+    const char *control = cweb_get_response_header_id(res, CWEB_HEADER_CACHE_CONTROL);
+    if (control && strcasestr(control, "private")) return false;
+    const char *vary = cweb_get_response_header_id(res, CWEB_HEADER_VARY);
+    return !vary || strcasecmp(vary, "Accept-Encoding") == 0;
+}
+
+// Waiters get any shareable status (an upstream error as well), only 200 is kept
+static bool response_storable(const Response *res) {
+    const char *control = cweb_get_response_header_id(res, CWEB_HEADER_CACHE_CONTROL);
+    return res->status_code == 200 && !(control && strcasestr(control, "no-store"));
+}
+
+static CacheFlight *flight_find(const char *key, size_t key_len, uint64_t hash) {
+    for (CacheFlight *f = flights; f; f = f->next) {
+        if (!f->resolving && f->hash == hash && f->key_len == key_len && memcmp(f->key, key, key_len) == 0) return f;
+    }
+    return NULL;
+}
+
+static void flight_unlink(CacheFlight *flight) {
+    CacheFlight **link = &flights;
+    while (*link != flight) link = &(*link)->next;
+    *link = flight->next;
+}
+
+static void flight_free(CacheFlight *flight) {
+    while (flight->waiters) {
+        CacheWaiter *w = flight->waiters;
+        flight->waiters = w->next;
+        free(w);
+    }
+    cweb_shared_body_release(flight->shared);
+    cweb_leak_tracker_record("cache_flight", flight, 0, false);
+    free(flight);
+}
+
+static void cache_resolve_cb(evutil_socket_t fd, short events, void *arg);
+
+// Waiters are answered from the event loop, never from inside the leader's
+// write or teardown
+static void flight_schedule(CacheFlight *flight) {
+    struct event_base *base = cweb_get_event_base();
+    if (!resolve_event && base) resolve_event = event_new(base, -1, 0, cache_resolve_cb, NULL);
+    if (!resolve_event) {
+        LOG_ERROR("SERVER_CACHE", "Cannot answer the requests waiting for %s", flight->key);
+        flight_unlink(flight);
+        flight_free(flight);
+        return;
+    }
+    event_active(resolve_event, EV_TIMEOUT, 0);
+}
+
+// Nothing new was stored: the next request past the ttl tries again
+static void cache_refresh_failed(const char *key, size_t key_len, uint64_t hash) {
+    pthread_rwlock_rdlock(&cache_lock);
+    CacheEntry *entry = cache_find(key, key_len, hash);
+    if (entry) __atomic_store_n(&entry->refreshing, false, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+// Leader is done: shared is what it rendered, NULL if nothing to share
+static void flight_finish(CacheFlight *flight, CwebSharedBody *shared) {
+    if (!flight->waiters) {
+        flight_unlink(flight);
+        cweb_shared_body_release(shared);
+        cweb_leak_tracker_record("cache_flight", flight, 0, false);
+        free(flight);
+        return;
+    }
+    flight->shared = shared;
+    flight->resolving = true;
+    flight_schedule(flight);
+}
+
+// Runs the handler for a waiter that got nothing to share, or took over
+static void waiter_render(CacheFlight *flight, Request *req, Response *res) {
+    route_handler_t handler = cweb_route_handler(flight->route, req);
+    if (handler) handler(req, res);
+    if (res->state == PROCESSED) cweb_response_complete(res);
+}
+
+static void flight_resolve(CacheFlight *flight) {
+    CacheWaiter *w;
+    while ((w = flight->waiters)) {
+        flight->waiters = w->next;
+        Response *res = w->res;
+        Request *req = w->req;
+        bool cancelled = w->cancelled;
+        free(w);
+        res->async_cancel = NULL;
+        res->async_data = NULL;
+        if (cancelled) {
+            cweb_response_complete(res); // Releases the orphan
+        } else if (flight->shared) {
+            cweb_response_share(res, flight->shared);
+            cweb_response_complete(res);
+        } else {
+            waiter_render(flight, req, res);
+        }
+    }
+    flight_unlink(flight);
+    flight_free(flight);
+}
+
+// The first GET waiter still connected renders in place of the leader
+static void flight_take_over(CacheFlight *flight) {
+    CacheWaiter **link = &flight->waiters;
+    while (*link && ((*link)->cancelled || (*link)->req->method_id != CWEB_METHOD_GET)) link = &(*link)->next;
+    CacheWaiter *w = *link;
+    flight->leaderless = false;
+    if (!w) {
+        if (flight->refresh) cache_refresh_failed(flight->key, flight->key_len, flight->hash);
+        flight_finish(flight, NULL);
+        return;
+    }
+    *link = w->next;
+    if (flight->waiters_tail == &w->next) flight->waiters_tail = link;
+    Request *req = w->req;
+    Response *res = w->res;
+    free(w);
+    res->async_cancel = NULL;
+    res->async_data = NULL;
+    req->cache_flight = flight;
+    waiter_render(flight, req, res);
+}
+
+static void cache_resolve_cb(evutil_socket_t fd, short events, void *arg) {
+    (void)fd;
+    (void)events;
+    (void)arg;
+    // Resolving may finish or start flights, so look again after each
+    for (;;) {
+        CacheFlight *f = flights;
+        while (f && !f->resolving && !f->leaderless) f = f->next;
+        if (!f) break;
+        if (f->resolving) {
+            flight_resolve(f);
+        } else {
+            flight_take_over(f);
+        }
+    }
+}
+
+static void cache_waiter_cancel(void *data) {
+    CacheWaiter *w = data;
+    w->cancelled = true;
+}
+
+CacheLookup server_cache_lookup(const Route *route, Request *req, Response *res) {
+    bool store = route->cache_ttl > 0 && server_response_cache_size() > 0;
+    if (!(store || route->coalesce) || req->using_session) return CACHE_MISS;
+    if (req->method_id != CWEB_METHOD_GET && req->method_id != CWEB_METHOD_HEAD) return CACHE_MISS;
+    size_t key_len;
+    const char *key = cache_key(route, req, &key_len);
+    if (!key) return CACHE_MISS;
+    uint64_t hash = cache_hash(key, key_len);
+
+    // Fresh, or stale while another request renders the next one
+    bool refresh = false;
+    uint64_t now = cache_now();
+    pthread_rwlock_rdlock(&cache_lock);
+    CacheEntry *entry = store ? cache_find(key, key_len, hash) : NULL;
+    if (entry && now < entry->stale_until) {
+        if (now >= entry->fresh_until && req->method_id == CWEB_METHOD_GET &&
+            !__atomic_exchange_n(&entry->refreshing, true, __ATOMIC_ACQ_REL)) {
+            refresh = true;
+        } else {
+            __atomic_store_n(&entry->referenced, true, __ATOMIC_RELAXED);
+            cweb_response_share(res, entry->shared);
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+    if (res->shared) return CACHE_HIT;
+
+    CacheFlight *flight = refresh ? NULL : flight_find(key, key_len, hash);
+    if (flight) {
+        CacheWaiter *w = calloc(1, sizeof(*w));
+        if (!w) return CACHE_MISS;
+        w->req = req;
+        w->res = res;
+        *flight->waiters_tail = w;
+        flight->waiters_tail = &w->next;
+        res->async_data = w;
+        res->async_cancel = cache_waiter_cancel;
+        res->state = PROCESSING;
+        return CACHE_WAIT;
+    }
+    if (req->method_id != CWEB_METHOD_GET) return CACHE_MISS;
+
+    flight = calloc(1, sizeof(*flight) + key_len);
+    if (!flight) {
+        if (refresh) cache_refresh_failed(key, key_len, hash);
+        return CACHE_MISS;
+    }
+    cweb_leak_tracker_record("cache_flight", flight, sizeof(*flight) + key_len, true);
+    flight->route = route;
+    flight->hash = hash;
+    flight->store = store;
+    flight->refresh = refresh;
+    flight->waiters_tail = &flight->waiters;
+    flight->key_len = key_len;
+    memcpy(flight->key, key, key_len);
+    flight->next = flights;
+    flights = flight;
+    req->cache_flight = flight;
+    return CACHE_FILL;
+}
+
+void server_cache_fill(Request *req, const Response *res) {
+    CacheFlight *flight = req->cache_flight;
+    if (!flight) return;
+    req->cache_flight = NULL;
+    CwebSharedBody *shared = response_shareable(res) ? cweb_shared_body_new(res) : NULL;
+    bool stored = shared && flight->store && response_storable(res) && cache_store(flight, shared);
+    if (!stored && flight->refresh) cache_refresh_failed(flight->key, flight->key_len, flight->hash);
+    flight_finish(flight, shared);
+}
+
+void server_cache_abandon(Request *req) {
+    CacheFlight *flight = req->cache_flight;
+    if (!flight) return;
+    req->cache_flight = NULL;
+    flight->leaderless = true;
+    flight_schedule(flight);
+}
+
+void server_cache_release_flights(void) {
+    while (flights) {
+        CacheFlight *flight = flights;
+        flights = flight->next;
+        flight_free(flight);
+    }
+    if (resolve_event) {
+        event_free(resolve_event);
+        resolve_event = NULL;
+    }
+}
+
+void server_cache_cleanup(void) {
+    pthread_rwlock_wrlock(&cache_lock);
+    while (oldest) cache_remove(oldest);
+    free(buckets);
+    buckets = NULL;
+    bucket_count = 0;
+    pthread_rwlock_unlock(&cache_lock);
+}
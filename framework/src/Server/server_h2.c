@@ -0,0 +1,598 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/server.h>
+#include <cweb/leak_detector.h>
+#include <cweb/speedbench.h>
+#include "server_internal.h"
+
+// HTTP/2 on top of a Connection. nghttp2 does framing, HPACK and flow
+// control; every stream becomes a Request that runs through the normal
+// dispatch (routes, sessions, async handlers, compression), its Response is
+// submitted on the stream once it is ready. Streams do not wait for each
+// other, Response.priority sets the stream urgency (RFC 9218) instead.
+
+#ifdef CWEB_HAVE_NGHTTP2
+
+#include <nghttp2/nghttp2.h>
+#include "http_header.h"
+#include <ctype.h>
+
+#define H2_MAX_CONCURRENT_STREAMS 100
+#define H2_MAX_HEADER_NAME 128
+
+typedef struct H2Stream {
+    int32_t id;
+    Request *req;               // Until dispatched, the exchange owns it after
+    body_handler_t body_handler;
+    struct evbuffer *body;      // Response body still to be framed
+    bool dispatched;
+    bool rejected;              // Already answered, further DATA is dropped
+    struct H2Stream *next;
+    struct H2Stream *prev;
+} H2Stream;
+
+typedef struct H2Session {
+    nghttp2_session *session;
+    Connection *conn;
+    H2Stream *streams;
+    int open_streams;
+    bool in_recv;               // Inside mem_recv, frames are sent afterwards
+} H2Session;
+
+bool server_h2_available(void) {
+    return true;
+}
+
+static void h2_respond(H2Session *h2, int32_t stream_id, Request *req, Response *res);
+
+static H2Stream *h2_stream_new(H2Session *h2, int32_t id) {
+    H2Stream *s = calloc(1, sizeof(H2Stream));
+    if (!s) return NULL;
+    s->req = cweb_create_request();
+    if (!s->req) {
+        free(s);
+        return NULL;
+    }
+    cweb_leak_tracker_record("h2.stream", s, sizeof(*s), true);
+    strcpy(s->req->version, "HTTP/2.0");
+    s->id = id;
+    s->next = h2->streams;
+    if (h2->streams) h2->streams->prev = s;
+    h2->streams = s;
+    h2->open_streams++;
+    return s;
+}
+
+static void h2_stream_free(H2Session *h2, H2Stream *s) {
+    if (s->prev) {
+        s->prev->next = s->next;
+    } else {
+        h2->streams = s->next;
+    }
+    if (s->next) s->next->prev = s->prev;
+    h2->open_streams--;
+
+    if (s->req) {
+        if (s->body_handler) s->body_handler(s->req, NULL, 0, true);
+        cweb_free_http_request(s->req);
+    }
+    if (s->body) evbuffer_free(s->body);
+    cweb_leak_tracker_record("h2.stream", s, sizeof(*s), false);
+    free(s);
+}
+
+// Answer a stream the route never sees (bad request, body too large)
+static void h2_reject(H2Session *h2, H2Stream *s, int status_code) {
+    LOG_DEBUG("HTTP2", "Rejecting stream %d with %d", s->id, status_code);
+    Response *res = cweb_create_response_for(s->req);
+    if (!res) {
+        nghttp2_submit_rst_stream(h2->session, NGHTTP2_FLAG_NONE, s->id, NGHTTP2_INTERNAL_ERROR);
+        return;
+    }
+    res->status_code = status_code;
+    res->body = (char *)cweb_get_status_message(status_code);
+    res->body_len = strlen(res->body);
+    res->isliteral = 1;
+    cweb_add_response_header(res, "Content-Type", "text/plain");
+    res->state = PROCESSED;
+
+    if (s->body_handler) {
+        s->body_handler(s->req, NULL, 0, true);
+        s->body_handler = NULL;
+    }
+    Request *req = s->req;
+    s->req = NULL;
+    s->rejected = true;
+    h2_respond(h2, s->id, req, res);
+}
+
+static void h2_dispatch(H2Session *h2, H2Stream *s) {
+    if (s->dispatched || s->rejected) return;
+    Request *req = s->req;
+    if (req->method[0] == '\0' || req->path[0] != '/') {
+        h2_reject(h2, s, 400);
+        return;
+    }
+    if (s->body_handler) {
+        s->body_handler(req, NULL, 0, true);
+        s->body_handler = NULL;
+    }
+    s->req = NULL;
+    s->dispatched = true;
+    server_dispatch(h2->conn, req, s->id);
+}
+
+/* nghttp2 callbacks */
+
+static ssize_t h2_send_cb(nghttp2_session *session, const uint8_t *data, size_t length, int flags, void *user_data) {
+    (void)session;
+    (void)flags;
+    H2Session *h2 = user_data;
+    struct evbuffer *output = bufferevent_get_output(h2->conn->bev);
+    size_t limit = server_output_high_watermark();
+    if (limit > 0 && evbuffer_get_length(output) >= limit) {
+        return NGHTTP2_ERR_WOULDBLOCK; // conn_write_cb sends the rest
+    }
+    if (evbuffer_add(output, data, length) != 0) {
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+    return (ssize_t)length;
+}
+
+// DATA payload goes from the stream's body buffer to the output without
+// passing through nghttp2
+static int h2_send_data_cb(nghttp2_session *session, nghttp2_frame *frame, const uint8_t *framehd,
+                           size_t length, nghttp2_data_source *source, void *user_data) {
+    (void)session;
+    (void)frame;
+    H2Session *h2 = user_data;
+    H2Stream *s = source->ptr;
+    struct evbuffer *output = bufferevent_get_output(h2->conn->bev);
+    size_t limit = server_output_high_watermark();
+    if (limit > 0 && evbuffer_get_length(output) >= limit) {
+        return NGHTTP2_ERR_WOULDBLOCK;
+    }
+    if (evbuffer_add(output, framehd, 9) != 0 ||
+        evbuffer_remove_buffer(s->body, output, length) != (int)length) {
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+    return 0;
+}
+
+static ssize_t h2_read_body_cb(nghttp2_session *session, int32_t stream_id, uint8_t *buf, size_t length,
+                               uint32_t *data_flags, nghttp2_data_source *source, void *user_data) {
+    (void)session;
+    (void)stream_id;
+    (void)buf;
+    (void)user_data;
+    H2Stream *s = source->ptr;
+    size_t left = evbuffer_get_length(s->body);
+    size_t n = left < length ? left : length;
+    *data_flags |= NGHTTP2_DATA_FLAG_NO_COPY;
+    if (n == left) *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    return (ssize_t)n;
+}
+
+static int h2_begin_headers_cb(nghttp2_session *session, const nghttp2_frame *frame, void *user_data) {
+    H2Session *h2 = user_data;
+    if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST) {
+        return 0;
+    }
+    H2Stream *s = h2_stream_new(h2, frame->hd.stream_id);
+    if (!s) {
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE; // Resets just this stream
+    }
+    nghttp2_session_set_stream_user_data(session, frame->hd.stream_id, s);
+    return 0;
+}
+
+static int h2_header_cb(nghttp2_session *session, const nghttp2_frame *frame,
+                        const uint8_t *name, size_t namelen, const uint8_t *value, size_t valuelen,
+                        uint8_t flags, void *user_data) {
+    (void)flags;
+    (void)user_data;
+    if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST) {
+        return 0; // Trailers are ignored like on HTTP/1
+    }
+    H2Stream *s = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
+    if (!s || !s->req || namelen >= H2_MAX_HEADER_NAME) return 0;
+    Request *req = s->req;
+
+    char key[H2_MAX_HEADER_NAME];
+    memcpy(key, name, namelen);
+    key[namelen] = '\0';
+    char *val = cweb_arena_strndup(&req->arena, (const char *)value, valuelen);
+    if (!val) return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+
+    if (key[0] == ':') {
+        if (strcmp(key, ":method") == 0 && valuelen < sizeof(req->method)) {
+            memcpy(req->method, val, valuelen + 1);
+            req->method_id = cweb_http_method(val, valuelen);
+        } else if (strcmp(key, ":path") == 0) {
+            if (valuelen >= MAX_PATH_LEN) return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+            req->path = val;
+            req->path_len = valuelen;
+        } else if (strcmp(key, ":authority") == 0) {
+            cweb_add_request_header(req, "Host", val);
+        }
+        return 0;
+    }
+
+    // Cookies may arrive split into several fields (RFC 9113 8.2.3)
+    if (strcmp(key, "cookie") == 0 && req->header_index[CWEB_HEADER_COOKIE]) {
+        Header *cookie = &req->headers[req->header_index[CWEB_HEADER_COOKIE] - 1];
+        size_t oldlen = cookie->value_len;
+        char *joined = cweb_request_alloc(req, oldlen + 2 + valuelen + 1);
+        if (!joined) return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        memcpy(joined, cookie->value, oldlen);
+        memcpy(joined + oldlen, "; ", 2);
+        memcpy(joined + oldlen + 2, val, valuelen + 1);
+        cookie->value = joined;
+        cookie->value_len = (uint32_t)(oldlen + 2 + valuelen);
+        return 0;
+    }
+    cweb_add_request_header(req, key, val);
+    return 0;
+}
+
+static int h2_data_chunk_cb(nghttp2_session *session, uint8_t flags, int32_t stream_id,
+                            const uint8_t *data, size_t len, void *user_data) {
+    (void)flags;
+    H2Session *h2 = user_data;
+    H2Stream *s = nghttp2_session_get_stream_user_data(session, stream_id);
+    if (!s || !s->req || s->rejected) return 0;
+
+    if (s->body_handler) {
+        s->req->body_len += len;
+        s->body_handler(s->req, (const char *)data, len, false);
+    } else if (!server_buffer_body(s->req, (const char *)data, len)) {
+        h2_reject(h2, s, 413);
+    }
+    return 0;
+}
+
+static int h2_frame_recv_cb(nghttp2_session *session, const nghttp2_frame *frame, void *user_data) {
+    H2Session *h2 = user_data;
+    if (frame->hd.type != NGHTTP2_HEADERS && frame->hd.type != NGHTTP2_DATA) {
+        return 0;
+    }
+    H2Stream *s = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
+    if (!s || !s->req) return 0;
+
+    if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+        const Route *route = cweb_match_route(s->req);
+        s->body_handler = route ? route->body_handler : NULL;
+    }
+    if (frame->hd.flags & NGHTTP2_FLAG_END_STREAM) {
+        h2_dispatch(h2, s);
+    }
+    return 0;
+}
+
+static int h2_stream_close_cb(nghttp2_session *session, int32_t stream_id, uint32_t error_code, void *user_data) {
+    H2Session *h2 = user_data;
+    H2Stream *s = nghttp2_session_get_stream_user_data(session, stream_id);
+    if (!s) return 0;
+    if (error_code != NGHTTP2_NO_ERROR) {
+        LOG_DEBUG("HTTP2", "Stream %d closed with error %u", stream_id, error_code);
+    }
+    if (s->dispatched) {
+        server_cancel_stream(h2->conn, stream_id); // No-op once answered
+    }
+    nghttp2_session_set_stream_user_data(session, stream_id, NULL);
+    h2_stream_free(h2, s);
+    return 0;
+}
+
+/* Responses */
+
+// Response.priority (0-100, higher first) onto urgency 0 (first) to 7
+static void h2_apply_priority(H2Session *h2, int32_t stream_id, int priority) {
+    if (priority <= 0) return; // Keep the client's own signal
+    nghttp2_extpri extpri;
+    extpri.urgency = priority >= 100 ? 0 : (uint32_t)(100 - priority) / 15;
+    if (extpri.urgency > NGHTTP2_EXTPRI_URGENCY_LOW) extpri.urgency = NGHTTP2_EXTPRI_URGENCY_LOW;
+    extpri.inc = 0;
+    nghttp2_session_change_extpri_stream_priority(h2->session, stream_id, &extpri, 1);
+}
+
+// Hop-by-hop fields have no meaning in HTTP/2 and make clients fail the stream
+static bool h2_connection_header(HeaderId id) {
+    return id == CWEB_HEADER_CONNECTION || id == CWEB_HEADER_KEEP_ALIVE ||
+           id == CWEB_HEADER_TRANSFER_ENCODING || id == CWEB_HEADER_UPGRADE ||
+           id == CWEB_HEADER_PROXY_CONNECTION || id == CWEB_HEADER_CONTENT_LENGTH;
+}
+
+static void h2_respond(H2Session *h2, int32_t stream_id, Request *req, Response *res) {
+    H2Stream *s = nghttp2_session_get_stream_user_data(h2->session, stream_id);
+    if (!s) {
+        LOG_DEBUG("HTTP2", "Stream %d gone, dropping response", stream_id);
+        cweb_free_http_response(res);
+        cweb_free_http_request(req);
+        return;
+    }
+
+    server_prepare_response(req, res);
+    cweb_speedbench_end(req);
+
+    const CwebHeaderBlock *block = res->header_block;
+    nghttp2_nv nva[MAX_HEADERS * 2 + 3];
+    char names[MAX_HEADERS][H2_MAX_HEADER_NAME];
+    char status[8];
+    char length[24];
+    size_t nvlen = 0;
+
+    snprintf(status, sizeof(status), "%03d", res->status_code % 1000);
+    nva[nvlen++] = (nghttp2_nv){ (uint8_t *)":status", (uint8_t *)status, 7, 3, NGHTTP2_NV_FLAG_NONE };
+    // Block names are lowercase already
+    for (int i = 0; block && i < block->header_count && i < MAX_HEADERS; i++) {
+        const Header *h = &block->headers[i];
+        if (h2_connection_header(h->id)) continue;
+        nva[nvlen++] = (nghttp2_nv){ (uint8_t *)h->key, (uint8_t *)h->value, h->key_len, h->value_len, NGHTTP2_NV_FLAG_NONE };
+    }
+    for (int i = 0; i < res->header_count; i++) {
+        const Header *h = &res->headers[i];
+        size_t keylen = h->key ? h->key_len : 0;
+        if (!h->value || keylen == 0 || keylen >= H2_MAX_HEADER_NAME || h2_connection_header(h->id)) continue;
+        // Field names are lowercase on HTTP/2, known ones already are
+        const char *name = http_header_names_lower[h->id];
+        if (h->id == CWEB_HEADER_UNKNOWN) {
+            for (size_t j = 0; j <= keylen; j++) names[i][j] = (char)tolower((unsigned char)h->key[j]);
+            name = names[i];
+        }
+        nva[nvlen++] = (nghttp2_nv){ (uint8_t *)name, (uint8_t *)h->value, keylen, h->value_len, NGHTTP2_NV_FLAG_NONE };
+    }
+    if (!res->header_index[CWEB_HEADER_DATE]) {
+        const char *date = cweb_http_date();
+        nva[nvlen++] = (nghttp2_nv){ (uint8_t *)"date", (uint8_t *)date, 4, strlen(date), NGHTTP2_NV_FLAG_NONE };
+    }
+    snprintf(length, sizeof(length), "%zu", res->body_len);
+    nva[nvlen++] = (nghttp2_nv){ (uint8_t *)"content-length", (uint8_t *)length, 14, strlen(length), NGHTTP2_NV_FLAG_NONE };
+
+    int rv;
+    s->body = evbuffer_new();
+    bool head_only = req->method_id == CWEB_METHOD_HEAD;
+    if (s->body && !head_only && res->body_len > 0 && server_response_body(res, s->body) == 0 &&
+        evbuffer_get_length(s->body) > 0) {
+        nghttp2_data_provider provider;
+        provider.source.ptr = s;
+        provider.read_callback = h2_read_body_cb;
+        rv = nghttp2_submit_response(h2->session, stream_id, nva, nvlen, &provider);
+    } else {
+        rv = nghttp2_submit_response(h2->session, stream_id, nva, nvlen, NULL);
+    }
+    if (rv != 0) {
+        LOG_ERROR("HTTP2", "submit_response on stream %d failed: %s", stream_id, nghttp2_strerror(rv));
+        nghttp2_submit_rst_stream(h2->session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_INTERNAL_ERROR);
+    } else {
+        h2_apply_priority(h2, stream_id, res->priority);
+    }
+    LOG_DEBUG("HTTP2", "Stream %d: response %d (%zu bytes body)", stream_id, res->status_code, res->body_len);
+
+    cweb_free_http_response(res); // nghttp2 keeps its own copy of the fields
+    cweb_free_http_request(req);
+}
+
+void server_h2_respond(Connection *conn, Exchange *ex) {
+    h2_respond(conn->h2, ex->stream_id, ex->req, ex->res);
+}
+
+/* Session */
+
+int server_h2_detect(struct evbuffer *input) {
+    char head[NGHTTP2_CLIENT_MAGIC_LEN];
+    size_t len = evbuffer_get_length(input);
+    size_t n = len < sizeof(head) ? len : sizeof(head);
+    if (evbuffer_copyout(input, head, n) != (ev_ssize_t)n) return 0;
+    if (memcmp(head, NGHTTP2_CLIENT_MAGIC, n) != 0) return 0;
+    return n == sizeof(head) ? 1 : -1;
+}
+
+bool server_h2_upgrade_requested(const Request *req) {
+    const char *upgrade = cweb_get_request_header_id(req, CWEB_HEADER_UPGRADE);
+    return upgrade && strcasecmp(upgrade, "h2c") == 0 &&
+           cweb_get_request_header_id(req, CWEB_HEADER_HTTP2_SETTINGS) != NULL &&
+           strcmp(req->version, "HTTP/1.1") == 0;
+}
+
+// HTTP2-Settings is base64url without padding
+static ssize_t h2_decode_settings(const char *in, uint8_t *out, size_t cap) {
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t n = 0;
+    for (; *in && *in != '='; in++) {
+        int v;
+        char c = *in;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if (c == '-' || c == '+') v = 62;
+        else if (c == '_' || c == '/') v = 63;
+        else return -1;
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (n == cap) return -1;
+            out[n++] = (uint8_t)(acc >> bits);
+        }
+    }
+    return (ssize_t)n;
+}
+
+int server_h2_start(Connection *conn, Request *upgrade) {
+    uint8_t settings_payload[256];
+    ssize_t settings_len = 0;
+    if (upgrade) {
+        settings_len = h2_decode_settings(cweb_get_request_header_id(upgrade, CWEB_HEADER_HTTP2_SETTINGS),
+                                          settings_payload, sizeof(settings_payload));
+        if (settings_len < 0) return -1;
+    }
+
+    H2Session *h2 = calloc(1, sizeof(H2Session));
+    if (!h2) return -1;
+    h2->conn = conn;
+
+    nghttp2_session_callbacks *callbacks;
+    if (nghttp2_session_callbacks_new(&callbacks) != 0) {
+        free(h2);
+        return -1;
+    }
+    nghttp2_session_callbacks_set_send_callback(callbacks, h2_send_cb);
+    nghttp2_session_callbacks_set_send_data_callback(callbacks, h2_send_data_cb);
+    nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, h2_begin_headers_cb);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, h2_header_cb);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, h2_data_chunk_cb);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, h2_frame_recv_cb);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, h2_stream_close_cb);
+    int rv = nghttp2_session_server_new(&h2->session, callbacks, h2);
+    nghttp2_session_callbacks_del(callbacks);
+    if (rv != 0) {
+        free(h2);
+        return -1;
+    }
+    cweb_leak_tracker_record("h2.session", h2, sizeof(*h2), true);
+
+    nghttp2_settings_entry settings[] = {
+        { NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, H2_MAX_CONCURRENT_STREAMS },
+        { NGHTTP2_SETTINGS_NO_RFC7540_PRIORITIES, 1 },
+    };
+    rv = nghttp2_submit_settings(h2->session, NGHTTP2_FLAG_NONE, settings, sizeof(settings) / sizeof(settings[0]));
+
+    H2Stream *first = NULL;
+    if (rv == 0 && upgrade) {
+        // The upgrading request becomes stream 1, already half closed
+        first = h2_stream_new(h2, 1);
+        rv = first ? nghttp2_session_upgrade2(h2->session, settings_payload, (size_t)settings_len,
+                                              upgrade->method_id == CWEB_METHOD_HEAD, first)
+                   : -1;
+    }
+    if (rv != 0) {
+        LOG_ERROR("HTTP2", "Could not start session: %s", rv < 0 ? nghttp2_strerror(rv) : "out of memory");
+        if (first) h2_stream_free(h2, first);
+        nghttp2_session_del(h2->session);
+        cweb_leak_tracker_record("h2.session", h2, sizeof(*h2), false);
+        free(h2);
+        return -1;
+    }
+    conn->h2 = h2;
+
+    if (upgrade) {
+        LOG_DEBUG("HTTP2", "Upgrading %s to h2c", upgrade->path);
+        // Servers get no stream user data from upgrade2, attach it ourselves
+        nghttp2_session_set_stream_user_data(h2->session, 1, first);
+        static const char switching[] = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+        bufferevent_write(conn->bev, switching, sizeof(switching) - 1);
+        cweb_free_http_request(first->req);
+        first->req = NULL;
+        first->dispatched = true;
+        server_dispatch(conn, upgrade, 1);
+    } else {
+        LOG_DEBUG("HTTP2", "Connection preface received");
+    }
+    return 0;
+}
+
+bool server_h2_send(Connection *conn) {
+    H2Session *h2 = conn->h2;
+    if (!h2 || h2->in_recv) return true;
+    int rv = nghttp2_session_send(h2->session);
+    if (rv != 0) {
+        LOG_DEBUG("HTTP2", "session_send failed: %s", nghttp2_strerror(rv));
+        return false;
+    }
+    return nghttp2_session_want_read(h2->session) || nghttp2_session_want_write(h2->session);
+}
+
+bool server_h2_input(Connection *conn) {
+    H2Session *h2 = conn->h2;
+    struct evbuffer *input = bufferevent_get_input(conn->bev);
+
+    h2->in_recv = true;
+    bool ok = true;
+    while (evbuffer_get_length(input) > 0) {
+        struct evbuffer_iovec vec;
+        if (evbuffer_peek(input, -1, NULL, &vec, 1) < 1) break;
+        ssize_t used = nghttp2_session_mem_recv(h2->session, vec.iov_base, vec.iov_len);
+        if (used < 0) {
+            LOG_INFO("HTTP2", "Protocol error: %s", nghttp2_strerror((int)used));
+            ok = false;
+            break;
+        }
+        evbuffer_drain(input, (size_t)used);
+    }
+    h2->in_recv = false;
+
+    // Still send what the session has queued, a GOAWAY for errors
+    return server_h2_send(conn) && ok;
+}
+
+bool server_h2_busy(const Connection *conn) {
+    return conn->h2 && conn->h2->open_streams > 0;
+}
+
+void server_h2_free(Connection *conn) {
+    H2Session *h2 = conn->h2;
+    if (!h2) return;
+    while (h2->streams) {
+        h2_stream_free(h2, h2->streams);
+    }
+    nghttp2_session_del(h2->session);
+    cweb_leak_tracker_record("h2.session", h2, sizeof(*h2), false);
+    free(h2);
+    conn->h2 = NULL;
+}
+
+#else /* !CWEB_HAVE_NGHTTP2 */
+
+bool server_h2_available(void) {
+    return false;
+}
+
+int server_h2_detect(struct evbuffer *input) {
+    (void)input;
+    return 0;
+}
+
+bool server_h2_upgrade_requested(const Request *req) {
+    (void)req;
+    return false;
+}
+
+int server_h2_start(Connection *conn, Request *upgrade) {
+    (void)conn;
+    (void)upgrade;
+    return -1;
+}
+
+bool server_h2_input(Connection *conn) {
+    (void)conn;
+    return false;
+}
+
+bool server_h2_send(Connection *conn) {
+    (void)conn;
+    return false;
+}
+
+void server_h2_respond(Connection *conn, Exchange *ex) {
+    (void)conn;
+    cweb_free_http_response(ex->res);
+    cweb_free_http_request(ex->req);
+}
+
+bool server_h2_busy(const Connection *conn) {
+    (void)conn;
+    return false;
+}
+
+void server_h2_free(Connection *conn) {
+    (void)conn;
+}
+
+#endif /* CWEB_HAVE_NGHTTP2 */
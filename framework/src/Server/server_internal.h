@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#ifndef CWEB_SERVER_INTERNAL_H
+#define CWEB_SERVER_INTERNAL_H
+
+#include <cweb/server.h>
+#include <stdint.h>
+#include "timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lifecycle of a client connection. Requests are framed one after another
+// from the input buffer; responses are written strictly in request order.
+typedef enum {
+    CONN_IDLE = 0,          // Waiting for the next request (keep-alive)
+    CONN_READING_HEADERS,   // Part of a request head has arrived
+    CONN_READING_BODY,      // Head parsed, body still arriving
+    CONN_CLOSING            // No more requests, close once output is flushed
+} ConnectionState;
+
+typedef enum {
+    BODY_LENGTH = 0,        // Content-Length framed
+    BODY_CHUNKED            // Transfer-Encoding: chunked
+} BodyFraming;
+
+typedef enum {
+    CHUNK_SIZE = 0,         // Expecting a chunk-size line
+    CHUNK_DATA,             // Inside chunk data
+    CHUNK_DATA_END,         // CRLF after chunk data
+    CHUNK_TRAILER           // Trailer fields after the last chunk
+} ChunkState;
+
+// One request/response pair in flight on a connection
+typedef struct Exchange {
+    Request *req;
+    Response *res;
+    struct Connection *conn; // NULL once the client is gone (orphaned async response)
+    bool ready;             // Response is complete and waits for its turn
+    bool close_after;       // Last response on this connection
+    struct Exchange *next;
+    struct Exchange *prev;  // Only used while orphaned
+    TimerWheelEntry deadline; // Armed while the response is pending
+    int32_t stream_id;      // HTTP/2 stream, 0 on HTTP/1 connections
+} Exchange;
+
+struct H2Session;
+
+typedef struct Connection {
+    struct bufferevent *bev;
+    ConnectionState state;
+    Exchange *head;         // Oldest request, answered first
+    Exchange *tail;
+    int in_flight;
+    bool processing;        // Guards against re-entering process_input
+    bool output_blocked;    // Reading paused until the client drains its responses
+    bool write_failed;      // A response could not be queued, the rest is dropped
+    struct event *header_timer; // Deadline for the request head being read
+    size_t head_scanned;    // Bytes of the pending head already searched for its end
+
+    // Body of the request currently being read
+    Request *current;
+    body_handler_t body_handler; // NULL = buffer into current->body
+    BodyFraming framing;
+    ChunkState chunk_state;
+    size_t body_remaining;  // Bytes left in the body or the current chunk
+    bool send_continue;     // Client sent Expect: 100-continue
+
+    struct H2Session *h2;   // Set once the connection speaks HTTP/2
+} Connection;
+
+/* server.c */
+Connection *server_connection_from_bev(struct bufferevent *bev);
+int server_async_timeout(void);
+// Counts a new connection against max_connections, false when full
+bool server_admit_connection(evutil_socket_t fd, const char *peer);
+void server_release_connection(void);
+// Runs an admitted connection on bev (socket or pair end), takes ownership
+Connection *server_open_connection(struct event_base *base, struct bufferevent *bev);
+// Hand a complete request to its route, answered on stream_id with HTTP/2
+void server_dispatch(Connection *conn, Request *req, int32_t stream_id);
+// Client reset an HTTP/2 stream whose response is not written yet
+void server_cancel_stream(Connection *conn, int32_t stream_id);
+// Buffer body bytes into req->body, false above max_body_size
+bool server_buffer_body(Request *req, const char *data, size_t len);
+// Compress as negotiated, then move the body into out
+void server_prepare_response(Request *req, Response *res);
+int server_response_body(Response *res, struct evbuffer *out);
+size_t server_output_high_watermark(void);
+
+/* server_h2.c */
+bool server_h2_available(void); // Built with nghttp2
+// 1 = input starts with the HTTP/2 preface, 0 = it does not, -1 = too short to tell
+int server_h2_detect(struct evbuffer *input);
+// HTTP/1.1 request asking for Upgrade: h2c
+bool server_h2_upgrade_requested(const Request *req);
+// Switch conn to HTTP/2; upgrade is the request that asked for it (or NULL)
+int server_h2_start(Connection *conn, Request *upgrade);
+// Feed buffered input to the session and write what it produces. false once
+// the session is over and the connection should close.
+bool server_h2_input(Connection *conn);
+bool server_h2_send(Connection *conn);
+void server_h2_respond(Connection *conn, Exchange *ex);
+bool server_h2_busy(const Connection *conn);
+void server_h2_free(Connection *conn);
+
+/* server_tls.c */
+bool server_tls_available(void); // Built with OpenSSL
+// Shared context for all workers, 0 on success
+int server_tls_init(const char *cert_file, const char *key_file, bool http2);
+bool server_tls_enabled(void);
+// Server side TLS on an accepted socket, or on top of underlying (io_uring pair)
+struct bufferevent *server_tls_accept(struct event_base *base, evutil_socket_t fd, struct bufferevent *underlying);
+// Handshake finished (BEV_EVENT_CONNECTED)
+void server_tls_connected(struct bufferevent *bev);
+void server_tls_cleanup(void);
+
+/* server_uring.c */
+typedef struct UringWorker UringWorker;
+// Ring, listener and accept loop for one worker, NULL if io_uring is unusable
+UringWorker *server_uring_open(struct event_base *base, const struct sockaddr_in *sin, bool reuse_port);
+void server_uring_close(UringWorker *worker);
+
+/* server_cache.c */
+typedef enum {
+    CACHE_MISS = 0,  // Not cached, run the handler
+    CACHE_HIT,       // res is answered from the stored response
+    CACHE_FILL,      // Run the handler, its response is stored and shared for the key
+    CACHE_WAIT       // An identical request is in flight, res stays PROCESSING until it is done
+} CacheLookup;
+size_t server_response_cache_size(void);
+// Route cache and request coalescing of route for req (see cweb_set_route_cache
+// and cweb_set_route_coalesce)
+CacheLookup server_cache_lookup(const Route *route, Request *req, Response *res);
+// Stores the final response of a CACHE_FILL request and answers its waiters
+void server_cache_fill(Request *req, const Response *res);
+// A CACHE_FILL request goes away unanswered, a waiter renders instead
+void server_cache_abandon(Request *req);
+void server_cache_release_flights(void); // Worker shutdown
+void server_cache_cleanup(void);
+
+/* server_pending.c */
+void server_orphan_exchange(Exchange *ex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CWEB_SERVER_INTERNAL_H */
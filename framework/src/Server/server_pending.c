@@ -6,114 +6,159 @@
  */
 
 #include <cweb/server.h>
-#include <event2/event.h>
 #include <cweb/leak_detector.h>
+#include <cweb/speedbench.h>
+#include "server_internal.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
-// Structure to track pending responses
-typedef struct pending_response {
-    Request *req;
-    Response *res;
-    struct bufferevent *bev;
-    struct pending_response *next;
-    bool cancelled;
-} pending_response_t;
+// Pending responses are the not yet ready exchanges of their connection
+// (res->pending points at the exchange), so completing one is O(1) and a
+// disconnect only touches its own requests. Responses whose client went
+// away before they completed are parked here until their handler finishes.
+static CWEB_THREAD_LOCAL Exchange *orphans = NULL;
+// Deadlines of this worker's pending responses
+static CWEB_THREAD_LOCAL TimerWheel deadlines;
+static CWEB_THREAD_LOCAL bool deadlines_ready = false;
 
-static pending_response_t *pending_responses = NULL;
-static struct event *check_timer = NULL;
+static void pending_deadline_expired(TimerWheelEntry *entry);
+
+static void arm_deadline(Exchange *ex, int seconds) {
+    if (seconds <= 0) return;
+    if (!deadlines_ready) {
+        struct event_base *base = cweb_get_event_base();
+        if (!base || timer_wheel_init(&deadlines, base) != 0) return;
+        deadlines_ready = true;
+    }
+    timer_wheel_add(&deadlines, &ex->deadline, (uint64_t)seconds * 1000u, pending_deadline_expired);
+}
+
+static void disarm_deadline(Exchange *ex) {
+    if (deadlines_ready) {
+        timer_wheel_cancel(&deadlines, &ex->deadline);
+    }
+}
 
-// Add a pending response to the list
 void cweb_add_pending_response(Request *req, Response *res, struct bufferevent *bev) {
-    pending_response_t *pending = malloc(sizeof(pending_response_t));
-    pending->req = req;
-    pending->res = res;
-    pending->bev = bev;
-    pending->next = pending_responses;
-    pending->cancelled = false;
-    pending_responses = pending;
-    cweb_leak_tracker_record("pending_struct", pending, sizeof(pending_response_t), true);
+    Connection *conn = server_connection_from_bev(bev);
+    Exchange *ex = conn ? conn->head : NULL;
+    while (ex && ex->res != res) {
+        ex = ex->next;
+    }
+    if (!ex) {
+        LOG_ERROR("SERVER_PENDING", "No exchange for pending response on bev %p", (void*)bev);
+        return;
+    }
+    res->pending = ex;
+
+    // Route deadline wins over the server wide one
+    const Route *route = cweb_match_route(req);
+    int timeout = route ? route->timeout : 0;
+    arm_deadline(ex, timeout > 0 ? timeout : server_async_timeout());
+}
+
+void server_orphan_exchange(Exchange *ex) {
+    Response *res = ex->res;
+    disarm_deadline(ex);
+    server_cache_abandon(ex->req);
+    if (res->async_cancel) {
+        res->async_cancel(res->async_data);
+        res->async_data = NULL;
+        res->async_cancel = NULL;
+    }
+    ex->conn = NULL;
+    ex->prev = NULL;
+    ex->next = orphans;
+    if (orphans) orphans->prev = ex;
+    orphans = ex;
 }
 
-void cweb_cancel_pending_responses(struct bufferevent *bev) {
-    pending_response_t *current = pending_responses;
-    while (current) {
-        if (current->bev == bev) {
-            current->bev = NULL;
-            current->cancelled = true;
-            if (current->res && current->res->async_cancel) {
-                current->res->async_cancel(current->res->async_data);
-                current->res->async_data = NULL;
-                current->res->async_cancel = NULL;
-            }
-        }
-        current = current->next;
+static void release_orphan(Exchange *ex) {
+    if (ex->prev) {
+        ex->prev->next = ex->next;
+    } else {
+        orphans = ex->next;
     }
+    if (ex->next) ex->next->prev = ex->prev;
+
+    cweb_free_http_response(ex->res);
+    cweb_free_http_request(ex->req);
+    cweb_leak_tracker_record("exchange", ex, sizeof(*ex), false);
+    free(ex);
 }
 
-// Timer callback to check for processed responses
-static void check_pending_responses(evutil_socket_t fd, short events, void *arg) {
-    (void)fd;     // Suppress unused parameter warning
-    (void)events; // Suppress unused parameter warning  
-    (void)arg;    // Suppress unused parameter warning
-    
-    pending_response_t **current = &pending_responses;
-    
-    while (*current) {
-        pending_response_t *pending = *current;
-        if (!pending || !pending->res) {
-            // Defensive: unlink invalid node
-            *current = pending ? pending->next : NULL;
-            if (pending) {
-                cweb_leak_tracker_record("pending_struct", pending, sizeof(pending_response_t), false);
-                free(pending);
-            }
-            continue;
-        }
-        
-        if (pending->res->state == PROCESSED) {
-            LOG_DEBUG("SERVER_PENDING", "Processing completed response for request");
-            *current = pending->next;
-
-            if (!pending->cancelled && pending->bev) {
-                cweb_send_response(pending->bev, pending->req, pending->res);
-            } else {
-                cweb_free_http_response(pending->res);
-                cweb_free_http_request(pending->req);
-            }
-
-            cweb_leak_tracker_record("pending_struct", pending, sizeof(pending_response_t), false);
-            free(pending);
-        } else {
-            /* advance to next pointer (no removal) */
-            current = &pending->next;
-        }
+void cweb_response_complete(Response *res) {
+    if (!res) return;
+    res->state = PROCESSED;
+
+    Exchange *ex = res->pending;
+    if (!ex) {
+        return; // Still inside the handler, the server sends it on return
+    }
+    res->pending = NULL;
+    disarm_deadline(ex);
+
+    if (!ex->conn) {
+        LOG_DEBUG("SERVER_PENDING", "Client gone, dropping completed response");
+        release_orphan(ex);
+        return;
     }
+    LOG_DEBUG("SERVER_PENDING", "Async response completed");
+    cweb_send_response(ex->conn->bev, ex->req, res);
 }
 
-// Initialize the pending response system
-void cweb_init_pending_responses(struct event_base *base) {
-    struct timeval tv = {0, 100000}; // Check every 100ms
-    check_timer = event_new(base, -1, EV_PERSIST, check_pending_responses, NULL);
-    cweb_leak_tracker_record("pending_checktimer", check_timer, 10, true);
-    event_add(check_timer, &tv);
+// The handler took too long: the client gets a 504 in place of its response,
+// which is cancelled and parked as an orphan until the handler lets go of it.
+// The orphan keeps the original request, the late response may still be
+// adding headers to its arena; the 504 goes out for a stand-in.
+static void pending_deadline_expired(TimerWheelEntry *entry) {
+    Exchange *ex = (Exchange *)((char *)entry - offsetof(Exchange, deadline));
+    Response *late = ex->res;
+    LOG_WARNING("SERVER_PENDING", "Deadline passed for %s, sending 504", ex->req->path);
+
+    Request *stand_in = cweb_create_request();
+    Response *res = cweb_create_response_for(stand_in);
+    Exchange *orphan = calloc(1, sizeof(Exchange));
+    if (!stand_in || !res || !orphan) {
+        LOG_ERROR("SERVER_PENDING", "Out of memory while timing out %s", ex->req->path);
+        cweb_free_http_response(res);
+        cweb_free_http_request(stand_in);
+        free(orphan);
+        return;
+    }
+    cweb_leak_tracker_record("exchange", orphan, sizeof(*orphan), true);
+    memcpy(stand_in->method, ex->req->method, sizeof(stand_in->method));
+    stand_in->method_id = ex->req->method_id;
+    stand_in->path = cweb_request_strdup(stand_in, ex->req->path);
+    if (!stand_in->path) stand_in->path = "";
+    stand_in->path_len = strlen(stand_in->path);
+    memcpy(stand_in->version, ex->req->version, sizeof(stand_in->version));
+    cweb_speedbench_end(ex->req);
+    orphan->req = ex->req;
+    orphan->res = late;
+    late->pending = orphan;
+    server_orphan_exchange(orphan);
+
+    res->status_code = 504;
+    res->body = strdup("Gateway Timeout");
+    res->body_len = res->body ? strlen(res->body) : 0;
+    if (res->body) cweb_leak_tracker_record(" res->body ", res->body, res->body_len, true);
+    cweb_add_response_header(res, "Content-Type", "text/plain");
+    res->state = PROCESSED;
+
+    ex->req = stand_in;
+    ex->res = res;
+    cweb_send_response(ex->conn->bev, stand_in, res);
 }
 
 // Cleanup pending responses
 void cweb_cleanup_pending_responses() {
-    if (check_timer) {
-        cweb_leak_tracker_record("pending_checktimer", check_timer, 10, false);
-        event_free(check_timer);
-        check_timer = NULL;
+    while (orphans) {
+        release_orphan(orphans);
     }
-    
-    while (pending_responses) {
-        pending_response_t *next = pending_responses->next;
-        cweb_leak_tracker_record("pending_responses->req", pending_responses->req, sizeof(pending_response_t), false);
-        cweb_free_http_request(pending_responses->req);
-        cweb_leak_tracker_record("pending_responses->req", pending_responses->res, sizeof(pending_response_t), false);
-        cweb_free_http_response(pending_responses->res);
-        cweb_leak_tracker_record("pending_responses", pending_responses, sizeof(pending_responses), false);
-        free(pending_responses);
-        pending_responses = next;
+    if (deadlines_ready) {
+        timer_wheel_destroy(&deadlines);
+        deadlines_ready = false;
     }
 }
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/server.h>
+#include "server_internal.h"
+
+// TLS termination with bufferevent_openssl. All workers share one SSL_CTX,
+// so its session cache and ticket keys let a client resume on whichever
+// worker the kernel hands the next connection to. Accepted sockets get
+// kTLS when the kernel and OpenSSL support it: records are then encrypted
+// by the kernel on the way out instead of in a user space copy.
+
+#ifdef CWEB_HAVE_TLS
+
+#include <event2/bufferevent_ssl.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#define TLS_SESSION_CACHE_SIZE (20 * 1024)
+#define TLS_SESSION_TIMEOUT 7200
+
+static SSL_CTX *tls_ctx = NULL;
+static bool tls_alpn_h2 = false;
+
+static void tls_log_errors(const char *what) {
+    unsigned long err;
+    char buf[256];
+    while ((err = ERR_get_error()) != 0) {
+        ERR_error_string_n(err, buf, sizeof(buf));
+        LOG_ERROR("TLS", "%s: %s", what, buf);
+    }
+}
+
+// Prefer h2 when HTTP/2 is on, fall back to http/1.1
+static int tls_alpn_select_cb(SSL *ssl, const unsigned char **out, unsigned char *outlen,
+                              const unsigned char *in, unsigned int inlen, void *arg) {
+    (void)ssl;
+    (void)arg;
+    static const unsigned char with_h2[] = "\x02h2\x08http/1.1";
+    static const unsigned char http11[] = "\x08http/1.1";
+    const unsigned char *ours = tls_alpn_h2 ? with_h2 : http11;
+    unsigned int ours_len = tls_alpn_h2 ? sizeof(with_h2) - 1 : sizeof(http11) - 1;
+    if (SSL_select_next_proto((unsigned char **)out, outlen, ours, ours_len, in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+bool server_tls_available(void) {
+    return true;
+}
+
+int server_tls_init(const char *cert_file, const char *key_file, bool http2) {
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx) {
+        tls_log_errors("SSL_CTX_new");
+        return -1;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_COMPRESSION | SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_ENABLE_KTLS);
+    SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS);
+
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert_file) != 1) {
+        tls_log_errors(cert_file);
+        SSL_CTX_free(ctx);
+        return -1;
+    }
+    if (SSL_CTX_use_PrivateKey_file(ctx, key_file, SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(ctx) != 1) {
+        tls_log_errors(key_file);
+        SSL_CTX_free(ctx);
+        return -1;
+    }
+
+    // Resumption: stateless tickets (TLS 1.3 and 1.2) plus the server side
+    // session cache for 1.2 clients that only send a session id
+    static const unsigned char session_context[] = "cweb";
+    SSL_CTX_set_session_id_context(ctx, session_context, sizeof(session_context) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, TLS_SESSION_CACHE_SIZE);
+    SSL_CTX_set_timeout(ctx, TLS_SESSION_TIMEOUT);
+
+    tls_alpn_h2 = http2;
+    SSL_CTX_set_alpn_select_cb(ctx, tls_alpn_select_cb, NULL);
+
+    tls_ctx = ctx;
+    LOG_INFO("TLS", "Serving HTTPS with %s", cert_file);
+    return 0;
+}
+
+bool server_tls_enabled(void) {
+    return tls_ctx != NULL;
+}
+
+struct bufferevent *server_tls_accept(struct event_base *base, evutil_socket_t fd, struct bufferevent *underlying) {
+    SSL *ssl = SSL_new(tls_ctx);
+    if (!ssl) {
+        tls_log_errors("SSL_new");
+        return NULL;
+    }
+    // Without an underlying bufferevent OpenSSL owns the socket, which is
+    // what kTLS needs. Over an io_uring pair it encrypts in user space.
+    struct bufferevent *bev = underlying
+        ? bufferevent_openssl_filter_new(base, underlying, ssl, BUFFEREVENT_SSL_ACCEPTING, BEV_OPT_CLOSE_ON_FREE)
+        : bufferevent_openssl_socket_new(base, fd, ssl, BUFFEREVENT_SSL_ACCEPTING, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        SSL_free(ssl);
+        return NULL;
+    }
+    // Most clients just close the socket without a close_notify
+    bufferevent_openssl_set_allow_dirty_shutdown(bev, 1);
+    return bev;
+}
+
+void server_tls_connected(struct bufferevent *bev) {
+    SSL *ssl = bufferevent_openssl_get_ssl(bev);
+    if (!ssl) return;
+    const unsigned char *alpn = NULL;
+    unsigned int alpn_len = 0;
+    SSL_get0_alpn_selected(ssl, &alpn, &alpn_len);
+    LOG_DEBUG("TLS", "Handshake done: %s, %s, ALPN %.*s, kTLS send %s", SSL_get_version(ssl),
+              SSL_session_reused(ssl) ? "resumed" : "full", alpn_len ? (int)alpn_len : 4,
+              alpn_len ? (const char *)alpn : "none",
+              BIO_ctrl(SSL_get_wbio(ssl), BIO_CTRL_GET_KTLS_SEND, 0, NULL) > 0 ? "on" : "off");
+}
+
+void server_tls_cleanup(void) {
+    if (tls_ctx) {
+        SSL_CTX_free(tls_ctx);
+        tls_ctx = NULL;
+    }
+}
+
+#else /* !CWEB_HAVE_TLS */
+
+bool server_tls_available(void) {
+    return false;
+}
+
+int server_tls_init(const char *cert_file, const char *key_file, bool http2) {
+    (void)cert_file;
+    (void)key_file;
+    (void)http2;
+    return -1;
+}
+
+bool server_tls_enabled(void) {
+    return false;
+}
+
+struct bufferevent *server_tls_accept(struct event_base *base, evutil_socket_t fd, struct bufferevent *underlying) {
+    (void)base;
+    (void)fd;
+    (void)underlying;
+    return NULL;
+}
+
+void server_tls_connected(struct bufferevent *bev) {
+    (void)bev;
+}
+
+void server_tls_cleanup(void) {
+}
+
+#endif /* CWEB_HAVE_TLS */
@@ -0,0 +1,600 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/server.h>
+#include <cweb/leak_detector.h>
+#include "server_internal.h"
+#include <event2/bufferevent.h>
+
+// io_uring backend: one ring per worker does accept, recv and send, the
+// connection logic stays on libevent. Every socket is paired with a
+// bufferevent pair; the connection owns one end like it would a socket
+// bufferevent, the ring moves bytes between the other end and the socket.
+// The ring's eventfd is an ordinary event on the worker loop, so timers,
+// async handlers and fetch keep running where they did.
+//
+// - multishot accept: one submission keeps accepting until it fails
+// - multishot recv into a provided buffer ring: no buffer per idle socket
+// - sends are gathered with evbuffer_peek and submitted once per loop pass
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define CWEB_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef CWEB_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define URING_SQ_ENTRIES 512
+#define URING_CQ_ENTRIES 4096
+#define URING_RECV_BUFFERS 256      // Power of two
+#define URING_RECV_BUFFER_SIZE 16384
+#define URING_RECV_GROUP 0
+#define URING_SEND_IOVECS 16
+// Unsent output per socket before the connection sees backpressure
+#define URING_SEND_HIGH_WATERMARK (256 * 1024)
+// Received bytes the connection has not taken yet before recv pauses
+#define URING_RECV_HIGH_WATERMARK (256 * 1024)
+
+// Low bits of user_data say which operation completed
+#define URING_OP_ACCEPT 1u
+#define URING_OP_RECV 2u
+#define URING_OP_SEND 3u
+#define URING_OP_MASK 3u
+
+struct UringWorker {
+    struct event_base *base;
+    int ring_fd;
+    int listen_fd;
+    int event_fd;
+    struct event *completion_event; // eventfd readable = CQEs waiting
+    struct event *submit_event;     // Deferred io_uring_enter for queued SQEs
+    bool submit_scheduled;
+    unsigned to_submit;
+
+    // Submission ring
+    void *sq_ring;
+    size_t sq_ring_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    // Completion ring (shares the sq mapping with FEAT_SINGLE_MMAP)
+    void *cq_ring;
+    size_t cq_ring_size;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // Provided receive buffers
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    char *buffers;
+    unsigned short buf_tail;
+};
+
+// Transport side of one accepted socket
+typedef struct UringConn {
+    UringWorker *worker;
+    int fd;
+    struct bufferevent *transport; // Our end of the pair
+    bool recv_armed;
+    bool recv_paused;              // Connection stopped reading, recv cancelled
+    bool send_inflight;
+    bool closing;                  // Connection is gone or the socket failed
+    bool shut;                     // shutdown() issued
+    struct msghdr msg;
+    struct iovec iov[URING_SEND_IOVECS];
+} UringConn;
+
+static void uring_conn_send(UringConn *c);
+static bool uring_arm_recv(UringConn *c);
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, 0, 0, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_submit(UringWorker *w) {
+    while (w->to_submit > 0) {
+        int ret = sys_io_uring_enter(w->ring_fd, w->to_submit);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EBUSY) {
+                LOG_ERROR("URING", "io_uring_enter failed: %s", strerror(errno));
+            }
+            return; // Retried on the next pass
+        }
+        w->to_submit -= (unsigned)ret;
+    }
+}
+
+static void uring_submit_cb(evutil_socket_t fd, short events, void *arg) {
+    (void)fd;
+    (void)events;
+    UringWorker *w = arg;
+    w->submit_scheduled = false;
+    uring_submit(w);
+    if (w->to_submit > 0) {
+        w->submit_scheduled = true;
+        event_active(w->submit_event, EV_TIMEOUT, 0);
+    }
+}
+
+// Next free SQE. Submissions are batched: the ring is entered once per loop
+// pass, or right away when it is full.
+static struct io_uring_sqe *uring_get_sqe(UringWorker *w) {
+    unsigned tail = *w->sq_tail;
+    unsigned head = __atomic_load_n(w->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= URING_SQ_ENTRIES) {
+        uring_submit(w);
+        head = __atomic_load_n(w->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= URING_SQ_ENTRIES) return NULL;
+    }
+    unsigned index = tail & *w->sq_mask;
+    struct io_uring_sqe *sqe = &w->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    w->sq_array[index] = index;
+    return sqe;
+}
+
+static void uring_queue_sqe(UringWorker *w) {
+    __atomic_store_n(w->sq_tail, *w->sq_tail + 1, __ATOMIC_RELEASE);
+    w->to_submit++;
+    if (!w->submit_scheduled) {
+        w->submit_scheduled = true;
+        event_active(w->submit_event, EV_TIMEOUT, 0);
+    }
+}
+
+static void uring_recycle_buffer(UringWorker *w, unsigned short bid) {
+    struct io_uring_buf *buf = &w->buf_ring->bufs[w->buf_tail & (URING_RECV_BUFFERS - 1)];
+    buf->addr = (unsigned long)(w->buffers + (size_t)bid * URING_RECV_BUFFER_SIZE);
+    buf->len = URING_RECV_BUFFER_SIZE;
+    buf->bid = bid;
+    w->buf_tail++;
+    __atomic_store_n(&w->buf_ring->tail, w->buf_tail, __ATOMIC_RELEASE);
+}
+
+static bool uring_arm_accept(UringWorker *w) {
+    struct io_uring_sqe *sqe = uring_get_sqe(w);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = w->listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = URING_OP_ACCEPT;
+    uring_queue_sqe(w);
+    return true;
+}
+
+static bool uring_arm_recv(UringConn *c) {
+    struct io_uring_sqe *sqe = uring_get_sqe(c->worker);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_RECV_GROUP;
+    sqe->user_data = (uint64_t)(uintptr_t)c | URING_OP_RECV;
+    uring_queue_sqe(c->worker);
+    c->recv_armed = true;
+    return true;
+}
+
+// The connection paused reading (pipeline limit, output backpressure):
+// stop receiving too instead of piling input up in the pair.
+static void uring_pause_recv(UringConn *c) {
+    if (c->recv_paused) return;
+    c->recv_paused = true;
+    if (!c->recv_armed) return;
+    struct io_uring_sqe *sqe = uring_get_sqe(c->worker);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = (uint64_t)(uintptr_t)c | URING_OP_RECV;
+    sqe->user_data = 0; // Completion is ignored
+    uring_queue_sqe(c->worker);
+}
+
+// Stop both directions: a pending multishot recv completes with 0, so the
+// connection is released once its last operation has come back.
+static void uring_conn_shutdown(UringConn *c) {
+    c->closing = true;
+    if (!c->shut) {
+        c->shut = true;
+        shutdown(c->fd, SHUT_RDWR);
+    }
+}
+
+// Tell the connection end of the pair that the socket is gone
+static void uring_conn_notify_closed(UringConn *c) {
+    if (bufferevent_pair_get_partner(c->transport)) {
+        bufferevent_flush(c->transport, EV_WRITE, BEV_FINISHED);
+    }
+}
+
+static void uring_conn_release(UringConn *c) {
+    if (c->recv_armed || c->send_inflight || !c->closing) return;
+    LOG_DEBUG("URING", "Releasing socket %d", c->fd);
+    uring_conn_notify_closed(c);
+    close(c->fd);
+    cweb_leak_tracker_record("bufferevent", c->transport, 0, false);
+    bufferevent_free(c->transport);
+    cweb_leak_tracker_record("uring_conn", c, sizeof(*c), false);
+    free(c);
+}
+
+// Output the connection wrote into its end of the pair
+static void uring_transport_read_cb(struct bufferevent *bev, void *ctx) {
+    (void)bev;
+    uring_conn_send(ctx);
+}
+
+// The connection took enough of its input to receive again
+static void uring_transport_write_cb(struct bufferevent *bev, void *ctx) {
+    (void)bev;
+    UringConn *c = ctx;
+    if (!c->recv_paused) return;
+    c->recv_paused = false;
+    if (!c->recv_armed && !c->closing && !uring_arm_recv(c)) {
+        uring_conn_shutdown(c);
+    }
+}
+
+// The connection end was flushed with BEV_FINISHED: it is closing, send
+// what is left and then drop the socket.
+static void uring_transport_event_cb(struct bufferevent *bev, short events, void *ctx) {
+    (void)bev;
+    UringConn *c = ctx;
+    if (!(events & BEV_EVENT_EOF)) return;
+    c->closing = true;
+    if (!c->send_inflight && evbuffer_get_length(bufferevent_get_input(c->transport)) == 0) {
+        uring_conn_shutdown(c);
+    }
+}
+
+static void uring_conn_send(UringConn *c) {
+    if (c->send_inflight || c->shut) return;
+    struct evbuffer *pending = bufferevent_get_input(c->transport);
+    if (evbuffer_get_length(pending) == 0) return;
+
+    int n = evbuffer_peek(pending, -1, NULL, c->iov, URING_SEND_IOVECS);
+    if (n > URING_SEND_IOVECS) n = URING_SEND_IOVECS;
+
+    struct io_uring_sqe *sqe = uring_get_sqe(c->worker);
+    if (!sqe) {
+        LOG_ERROR("URING", "Submission ring full, dropping socket %d", c->fd);
+        uring_conn_shutdown(c);
+        return;
+    }
+    memset(&c->msg, 0, sizeof(c->msg));
+    c->msg.msg_iov = c->iov;
+    c->msg.msg_iovlen = (size_t)n;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = c->fd;
+    sqe->addr = (unsigned long)&c->msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)c | URING_OP_SEND;
+    uring_queue_sqe(c->worker);
+    c->send_inflight = true;
+}
+
+static void uring_handle_accept(UringWorker *w, struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        uring_arm_accept(w); // Multishot ended (error or overflow), start over
+    }
+    if (cqe->res < 0) {
+        LOG_WARNING("URING", "accept failed: %s", strerror(-cqe->res));
+        return;
+    }
+
+    int fd = cqe->res;
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+    char ip[INET_ADDRSTRLEN] = "?";
+    if (getpeername(fd, (struct sockaddr*)&sin, &len) == 0) {
+        inet_ntop(AF_INET, &sin.sin_addr, ip, sizeof(ip));
+        LOG_INFO("SERVER", "New connection from %s:%d", ip, ntohs(sin.sin_port));
+    }
+    if (!server_admit_connection(fd, ip)) {
+        close(fd);
+        return;
+    }
+
+    UringConn *c = calloc(1, sizeof(UringConn));
+    struct bufferevent *pair[2] = { NULL, NULL };
+    if (!c || bufferevent_pair_new(w->base, 0, pair) != 0) {
+        LOG_ERROR("URING", "Error allocating connection state");
+        free(c);
+        server_release_connection();
+        close(fd);
+        return;
+    }
+    cweb_leak_tracker_record("uring_conn", c, sizeof(*c), true);
+    cweb_leak_tracker_record("bufferevent", pair[1], 0, true);
+    c->worker = w;
+    c->fd = fd;
+    c->transport = pair[1];
+
+    // Bounded hand-over: unsent output stays with the connection end, where
+    // the output watermark sees it
+    bufferevent_setcb(c->transport, uring_transport_read_cb, uring_transport_write_cb, uring_transport_event_cb, c);
+    bufferevent_setwatermark(c->transport, EV_READ, 0, URING_SEND_HIGH_WATERMARK);
+    bufferevent_setwatermark(c->transport, EV_WRITE, URING_RECV_HIGH_WATERMARK / 2, 0);
+    bufferevent_enable(c->transport, EV_READ | EV_WRITE);
+
+    // TLS runs as a filter on the connection end of the pair
+    struct bufferevent *bev = server_tls_enabled() ? server_tls_accept(w->base, -1, pair[0]) : pair[0];
+    if (!bev) {
+        LOG_ERROR("URING", "Error setting up TLS for socket %d", fd);
+        bufferevent_free(pair[0]);
+        server_release_connection();
+    }
+    if (!bev || !server_open_connection(w->base, bev) || !uring_arm_recv(c)) {
+        uring_conn_shutdown(c);
+        uring_conn_release(c);
+    }
+}
+
+static void uring_handle_recv(UringConn *c, struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        c->recv_armed = false;
+    }
+
+    if (cqe->res > 0) {
+        unsigned short bid = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        const char *data = c->worker->buffers + (size_t)bid * URING_RECV_BUFFER_SIZE;
+        if (!c->closing) {
+            // Lands in the connection's input and runs its read callback
+            bufferevent_write(c->transport, data, (size_t)cqe->res);
+        }
+        uring_recycle_buffer(c->worker, bid);
+        if (!c->closing && evbuffer_get_length(bufferevent_get_output(c->transport)) > URING_RECV_HIGH_WATERMARK) {
+            uring_pause_recv(c);
+        }
+        if (!c->recv_armed && !c->recv_paused && !c->closing && !uring_arm_recv(c)) {
+            uring_conn_shutdown(c);
+        }
+    } else if (cqe->res == -ECANCELED && c->recv_paused) {
+        // Paused, the transport write callback arms it again
+    } else if (cqe->res == -ENOBUFS && !c->closing) {
+        // All buffers were handed out, they are back by now
+        if (!c->recv_armed && !uring_arm_recv(c)) {
+            uring_conn_shutdown(c);
+        }
+    } else if (!c->recv_armed) {
+        // EOF or error: close the connection, then the socket
+        if (cqe->res < 0 && cqe->res != -ECONNRESET) {
+            LOG_DEBUG("URING", "recv on %d failed: %s", c->fd, strerror(-cqe->res));
+        }
+        uring_conn_shutdown(c);
+        uring_conn_notify_closed(c);
+    }
+    uring_conn_release(c);
+}
+
+static void uring_handle_send(UringConn *c, struct io_uring_cqe *cqe) {
+    c->send_inflight = false;
+    struct evbuffer *pending = bufferevent_get_input(c->transport);
+
+    if (cqe->res < 0) {
+        if (cqe->res != -EPIPE && cqe->res != -ECONNRESET) {
+            LOG_DEBUG("URING", "send on %d failed: %s", c->fd, strerror(-cqe->res));
+        }
+        evbuffer_drain(pending, evbuffer_get_length(pending));
+        uring_conn_shutdown(c);
+        uring_conn_notify_closed(c);
+    } else {
+        // Draining lets the pair move more of the connection's output over
+        evbuffer_drain(pending, (size_t)cqe->res);
+        if (evbuffer_get_length(pending) > 0) {
+            uring_conn_send(c);
+        } else if (c->closing) {
+            uring_conn_shutdown(c);
+        }
+    }
+    uring_conn_release(c);
+}
+
+static void uring_completion_cb(evutil_socket_t fd, short events, void *arg) {
+    (void)events;
+    UringWorker *w = arg;
+    uint64_t signalled;
+    if (read(fd, &signalled, sizeof(signalled)) < 0 && errno != EAGAIN) {
+        LOG_WARNING("URING", "eventfd read failed: %s", strerror(errno));
+    }
+
+    unsigned head = *w->cq_head;
+    for (;;) {
+        unsigned tail = __atomic_load_n(w->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) break;
+        struct io_uring_cqe cqe = w->cqes[head & *w->cq_mask];
+        head++;
+        // Hand the slot back before the callbacks queue new work
+        __atomic_store_n(w->cq_head, head, __ATOMIC_RELEASE);
+
+        unsigned op = (unsigned)(cqe.user_data & URING_OP_MASK);
+        UringConn *c = (UringConn *)(uintptr_t)(cqe.user_data & ~(uint64_t)URING_OP_MASK);
+        switch (op) {
+            case URING_OP_ACCEPT: uring_handle_accept(w, &cqe); break;
+            case URING_OP_RECV:   uring_handle_recv(c, &cqe); break;
+            case URING_OP_SEND:   uring_handle_send(c, &cqe); break;
+            default: break;
+        }
+    }
+}
+
+static int uring_map_rings(UringWorker *w, struct io_uring_params *p) {
+    w->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    w->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    bool single = p->features & IORING_FEAT_SINGLE_MMAP;
+    if (single && w->cq_ring_size > w->sq_ring_size) w->sq_ring_size = w->cq_ring_size;
+
+    w->sq_ring = mmap(NULL, w->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd, IORING_OFF_SQ_RING);
+    if (w->sq_ring == MAP_FAILED) { w->sq_ring = NULL; return -1; }
+    if (single) {
+        w->cq_ring = w->sq_ring;
+    } else {
+        w->cq_ring = mmap(NULL, w->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd, IORING_OFF_CQ_RING);
+        if (w->cq_ring == MAP_FAILED) { w->cq_ring = NULL; return -1; }
+    }
+    w->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    w->sqes = mmap(NULL, w->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd, IORING_OFF_SQES);
+    if (w->sqes == MAP_FAILED) { w->sqes = NULL; return -1; }
+
+    char *sq = w->sq_ring;
+    char *cq = w->cq_ring;
+    w->sq_head = (unsigned *)(sq + p->sq_off.head);
+    w->sq_tail = (unsigned *)(sq + p->sq_off.tail);
+    w->sq_mask = (unsigned *)(sq + p->sq_off.ring_mask);
+    w->sq_array = (unsigned *)(sq + p->sq_off.array);
+    w->cq_head = (unsigned *)(cq + p->cq_off.head);
+    w->cq_tail = (unsigned *)(cq + p->cq_off.tail);
+    w->cq_mask = (unsigned *)(cq + p->cq_off.ring_mask);
+    w->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+    return 0;
+}
+
+static int uring_setup_buffers(UringWorker *w) {
+    w->buf_ring_size = URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+    w->buf_ring = mmap(NULL, w->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (w->buf_ring == MAP_FAILED) { w->buf_ring = NULL; return -1; }
+    w->buffers = malloc((size_t)URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE);
+    if (!w->buffers) return -1;
+    cweb_leak_tracker_record("uring.buffers", w->buffers, (size_t)URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE, true);
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)w->buf_ring;
+    reg.ring_entries = URING_RECV_BUFFERS;
+    reg.bgid = URING_RECV_GROUP;
+    if (sys_io_uring_register(w->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) return -1;
+
+    for (unsigned short i = 0; i < URING_RECV_BUFFERS; i++) {
+        uring_recycle_buffer(w, i);
+    }
+    return 0;
+}
+
+static int uring_listen(const struct sockaddr_in *sin, bool reuse_port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (reuse_port) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    }
+    if (bind(fd, (const struct sockaddr *)sin, sizeof(*sin)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("Couldn't create listener");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+UringWorker *server_uring_open(struct event_base *base, const struct sockaddr_in *sin, bool reuse_port) {
+    UringWorker *w = calloc(1, sizeof(UringWorker));
+    if (!w) return NULL;
+    cweb_leak_tracker_record("uring_worker", w, sizeof(*w), true);
+    w->base = base;
+    w->listen_fd = -1;
+    w->event_fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+    w->ring_fd = sys_io_uring_setup(URING_SQ_ENTRIES, &params);
+    if (w->ring_fd < 0) {
+        LOG_WARNING("URING", "io_uring_setup failed: %s", strerror(errno));
+        server_uring_close(w);
+        return NULL;
+    }
+    if (uring_map_rings(w, &params) != 0 || uring_setup_buffers(w) != 0) {
+        LOG_WARNING("URING", "io_uring ring setup failed: %s", strerror(errno));
+        server_uring_close(w);
+        return NULL;
+    }
+
+    w->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->event_fd < 0 || sys_io_uring_register(w->ring_fd, IORING_REGISTER_EVENTFD, &w->event_fd, 1) != 0) {
+        LOG_WARNING("URING", "Could not register eventfd: %s", strerror(errno));
+        server_uring_close(w);
+        return NULL;
+    }
+    w->completion_event = event_new(base, w->event_fd, EV_READ | EV_PERSIST, uring_completion_cb, w);
+    w->submit_event = event_new(base, -1, 0, uring_submit_cb, w);
+    if (!w->completion_event || !w->submit_event || event_add(w->completion_event, NULL) != 0) {
+        server_uring_close(w);
+        return NULL;
+    }
+
+    w->listen_fd = uring_listen(sin, reuse_port);
+    if (w->listen_fd < 0 || !uring_arm_accept(w)) {
+        server_uring_close(w);
+        return NULL;
+    }
+    return w;
+}
+
+// Sockets still open at shutdown go with the ring; their pairs go with the
+// event base.
+void server_uring_close(UringWorker *w) {
+    if (!w) return;
+    if (w->completion_event) event_free(w->completion_event);
+    if (w->submit_event) event_free(w->submit_event);
+    if (w->listen_fd >= 0) close(w->listen_fd);
+    if (w->event_fd >= 0) close(w->event_fd);
+    if (w->sqes) munmap(w->sqes, w->sqes_size);
+    if (w->cq_ring && w->cq_ring != w->sq_ring) munmap(w->cq_ring, w->cq_ring_size);
+    if (w->sq_ring) munmap(w->sq_ring, w->sq_ring_size);
+    if (w->ring_fd >= 0) close(w->ring_fd);
+    if (w->buf_ring) munmap(w->buf_ring, w->buf_ring_size);
+    if (w->buffers) {
+        cweb_leak_tracker_record("uring.buffers", w->buffers, (size_t)URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE, false);
+        free(w->buffers);
+    }
+    cweb_leak_tracker_record("uring_worker", w, sizeof(*w), false);
+    free(w);
+}
+
+#else /* !CWEB_HAVE_IO_URING */
+
+UringWorker *server_uring_open(struct event_base *base, const struct sockaddr_in *sin, bool reuse_port) {
+    (void)base;
+    (void)sin;
+    (void)reuse_port;
+    LOG_WARNING("URING", "Built without io_uring support");
+    return NULL;
+}
+
+void server_uring_close(UringWorker *w) {
+    (void)w;
+}
+
+#endif /* CWEB_HAVE_IO_URING */
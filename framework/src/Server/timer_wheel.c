@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include "timer_wheel.h"
+#include <cweb/logger.h>
+#include <cweb/leak_detector.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static uint64_t wheel_now(const TimerWheel *wheel) {
+    return (monotonic_ms() - wheel->start_ms) / TIMER_WHEEL_TICK_MS;
+}
+
+// hlist style links: pprev points at whatever holds the pointer to us,
+// so an entry can be unlinked without knowing which list it is on.
+static void entry_link(TimerWheelEntry **head, TimerWheelEntry *entry) {
+    entry->next = *head;
+    if (*head) (*head)->pprev = &entry->next;
+    *head = entry;
+    entry->pprev = head;
+}
+
+static void entry_unlink(TimerWheelEntry *entry) {
+    *entry->pprev = entry->next;
+    if (entry->next) entry->next->pprev = entry->pprev;
+    entry->next = NULL;
+    entry->pprev = NULL;
+}
+
+static void wheel_process_slot(TimerWheel *wheel, uint64_t tick) {
+    TimerWheelEntry **slot = &wheel->slots[tick % TIMER_WHEEL_SLOTS];
+
+    // Detach the slot first: callbacks may arm or cancel timers meanwhile
+    TimerWheelEntry *pending = *slot;
+    *slot = NULL;
+    if (pending) pending->pprev = &pending;
+
+    while (pending) {
+        TimerWheelEntry *entry = pending;
+        entry_unlink(entry);
+        if (entry->expires <= tick) {
+            wheel->count--;
+            entry->cb(entry);
+        } else {
+            entry_link(slot, entry); // Due in a later round
+        }
+    }
+}
+
+static void wheel_tick_cb(evutil_socket_t fd, short events, void *arg) {
+    (void)fd;
+    (void)events;
+    TimerWheel *wheel = arg;
+
+    uint64_t now = wheel_now(wheel);
+    while (wheel->current < now && wheel->count > 0) {
+        wheel->current++;
+        wheel_process_slot(wheel, wheel->current);
+    }
+    wheel->current = now;
+
+    if (wheel->count == 0) {
+        event_del(wheel->driver);
+    }
+}
+
+int timer_wheel_init(TimerWheel *wheel, struct event_base *base) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->start_ms = monotonic_ms();
+    wheel->driver = event_new(base, -1, EV_PERSIST, wheel_tick_cb, wheel);
+    if (!wheel->driver) {
+        LOG_ERROR("TIMER_WHEEL", "Failed to create wheel driver event");
+        return -1;
+    }
+    cweb_leak_tracker_record("timer_wheel.driver", wheel->driver, 0, true);
+    return 0;
+}
+
+void timer_wheel_destroy(TimerWheel *wheel) {
+    if (wheel->driver) {
+        cweb_leak_tracker_record("timer_wheel.driver", wheel->driver, 0, false);
+        event_free(wheel->driver);
+        wheel->driver = NULL;
+    }
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        while (wheel->slots[i]) {
+            entry_unlink(wheel->slots[i]);
+        }
+    }
+    wheel->count = 0;
+}
+
+void timer_wheel_add(TimerWheel *wheel, TimerWheelEntry *entry, uint64_t timeout_ms, timer_wheel_cb cb) {
+    if (!wheel->driver) return;
+    if (timer_wheel_armed(entry)) {
+        timer_wheel_cancel(wheel, entry);
+    }
+
+    uint64_t now = wheel_now(wheel);
+    if (wheel->count == 0) {
+        wheel->current = now; // Driver was idle, nothing to catch up on
+    }
+
+    uint64_t ticks = (timeout_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    entry->expires = now + (ticks > 0 ? ticks : 1);
+    entry->cb = cb;
+    entry_link(&wheel->slots[entry->expires % TIMER_WHEEL_SLOTS], entry);
+
+    if (wheel->count++ == 0) {
+        struct timeval tick = { 0, TIMER_WHEEL_TICK_MS * 1000 };
+        event_add(wheel->driver, &tick);
+    }
+}
+
+void timer_wheel_cancel(TimerWheel *wheel, TimerWheelEntry *entry) {
+    if (!timer_wheel_armed(entry)) return;
+    entry_unlink(entry);
+    if (--wheel->count == 0 && wheel->driver) {
+        event_del(wheel->driver);
+    }
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#ifndef CWEB_TIMER_WHEEL_H
+#define CWEB_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <event2/event.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hashed timer wheel: entries hang in the slot of their expiry tick, so
+// arming and cancelling are O(1) no matter how many timers are outstanding.
+// One libevent timer drives the wheel and only runs while entries exist.
+
+#define TIMER_WHEEL_SLOTS 512
+#define TIMER_WHEEL_TICK_MS 100
+
+struct TimerWheelEntry;
+typedef void (*timer_wheel_cb)(struct TimerWheelEntry *entry);
+
+// Embedded into the owning struct, recover it with offsetof
+typedef struct TimerWheelEntry {
+    struct TimerWheelEntry *next;
+    struct TimerWheelEntry **pprev; // NULL while not armed
+    uint64_t expires;               // Absolute tick
+    timer_wheel_cb cb;
+} TimerWheelEntry;
+
+typedef struct {
+    TimerWheelEntry *slots[TIMER_WHEEL_SLOTS];
+    uint64_t current;               // Last processed tick
+    uint64_t start_ms;
+    size_t count;
+    struct event *driver;
+} TimerWheel;
+
+int timer_wheel_init(TimerWheel *wheel, struct event_base *base);
+void timer_wheel_destroy(TimerWheel *wheel);
+void timer_wheel_add(TimerWheel *wheel, TimerWheelEntry *entry, uint64_t timeout_ms, timer_wheel_cb cb);
+void timer_wheel_cancel(TimerWheel *wheel, TimerWheelEntry *entry);
+
+static inline bool timer_wheel_armed(const TimerWheelEntry *entry) {
+    return entry->pprev != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CWEB_TIMER_WHEEL_H */
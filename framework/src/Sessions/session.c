@@ -11,10 +11,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/random.h>
 
 #define SESSION_STORE_SIZE 1024
 
 static Session* session_store[SESSION_STORE_SIZE];
+// Shared by all worker threads
+static pthread_mutex_t session_store_lock = PTHREAD_MUTEX_INITIALIZER;
 
 // Simple djb2 hash function
 static unsigned long hash(const char *str) {
@@ -28,36 +31,67 @@ static unsigned long hash(const char *str) {
 
 void session_store_init() {
 	LOG_DEBUG("SESSION", "Initializing session store");
+    pthread_mutex_lock(&session_store_lock);
     memset(session_store, 0, sizeof(session_store));
+    pthread_mutex_unlock(&session_store_lock);
 
 }
 
+static void free_retired(Session *s) {
+    for (int i = 0; i < s->retired_count; i++) {
+        free(s->retired[i]);
+    }
+    free(s->retired);
+    s->retired = NULL;
+    s->retired_count = 0;
+}
+
 static void free_session(Session *s) {
-	LOG_DEBUG("SESSION", "Freeing session: %s", s->id);
     if (!s) return;
+	LOG_DEBUG("SESSION", "Freeing session: %s", s->id);
     for (int i = 0; i < s->data_count; i++) {
         free(s->data[i].key);
         free(s->data[i].value);
     }
+    free_retired(s);
     free(s);
 }
 
+// Store lock held. Replaced values outlive every request that could have
+// read them, the session the last reference.
+static void unref_session(Session *s) {
+    if (--s->refs == 0) {
+        free_session(s);
+    } else if (s->refs == 1 && s->stored) {
+        free_retired(s);
+    }
+}
+
 void session_store_destroy() {
 	LOG_DEBUG("SESSION", "Destroying session store");
+    pthread_mutex_lock(&session_store_lock);
     for (int i = 0; i < SESSION_STORE_SIZE; i++) {
         Session *current = session_store[i];
         while (current) {
             Session *next = current->next;
-            free_session(current);
+            current->stored = false;
+            unref_session(current);
             current = next;
         }
+        session_store[i] = NULL;
     }
+    pthread_mutex_unlock(&session_store_lock);
 }
 
 static void generate_session_id(char *id_buf) {
 	LOG_DEBUG("SESSION", "Generating new session ID");
     unsigned char random_bytes[SESSION_ID_LEN / 2];
-  
+    size_t filled = 0;
+    while (filled < sizeof(random_bytes)) {
+        ssize_t n = getrandom(random_bytes + filled, sizeof(random_bytes) - filled, 0);
+        if (n > 0) filled += (size_t)n;
+    }
+
     for (size_t i = 0; i < sizeof(random_bytes); i++) {
         sprintf(id_buf + (i * 2), "%02x", random_bytes[i]);
     }
@@ -66,23 +100,30 @@ static void generate_session_id(char *id_buf) {
 Session* get_or_create_session(const char *session_id) {
 
 	LOG_DEBUG("SESSION", "Getting or creating session with ID: %s", session_id ? session_id : "NULL");
+    pthread_mutex_lock(&session_store_lock);
     // Trying to find existing session
     if (session_id) {
         unsigned long h = hash(session_id) % SESSION_STORE_SIZE;
-        Session *s = session_store[h];
-        while (s) {
+        Session **link = &session_store[h];
+        while (*link) {
+            Session *s = *link;
             if (strcmp(s->id, session_id) == 0) {
                 if (time(NULL) < s->expires) {
 					LOG_DEBUG("SESSION", "Found valid session with ID: %s", s->id);
                     s->expires = time(NULL) + SESSION_LIFETIME; // Refresh lifetime
+                    s->refs++;
+                    pthread_mutex_unlock(&session_store_lock);
                     return s;
-                } else {
-                    // Session expired, will be removed. Fall through to create new.
-					LOG_DEBUG("SESSION", "Session expired: %s", s->id);
-                    break;
                 }
+                // Expired: out of the store, freed once its last request is done.
+                // Fall through to create a new one.
+				LOG_DEBUG("SESSION", "Session expired: %s", s->id);
+                *link = s->next;
+                s->stored = false;
+                unref_session(s);
+                break;
             }
-            s = s->next;
+            link = &s->next;
         }
     }
 
@@ -90,40 +131,67 @@ Session* get_or_create_session(const char *session_id) {
     Session *new_session = calloc(1, sizeof(Session));
 	LOG_DEBUG("SESSION", "Allocating new session");
     if (!new_session) {
+        pthread_mutex_unlock(&session_store_lock);
         return NULL;
     }
 
     generate_session_id(new_session->id);
 	LOG_DEBUG("SESSION", "New session ID generated: %s", new_session->id);
     new_session->expires = time(NULL) + SESSION_LIFETIME;
+    new_session->refs = 2; // Store and caller
+    new_session->stored = true;
     
     unsigned long h = hash(new_session->id) % SESSION_STORE_SIZE;
 	LOG_DEBUG("SESSION", "Storing session with ID: %s at index: %lu", new_session->id, h);
     new_session->next = session_store[h];
     session_store[h] = new_session;
+    pthread_mutex_unlock(&session_store_lock);
 
     return new_session;
 }
 
+void release_session(Session *s) {
+    if (!s) return;
+    pthread_mutex_lock(&session_store_lock);
+    unref_session(s);
+    pthread_mutex_unlock(&session_store_lock);
+}
+
 const char* get_session_value(Session *s, const char *key) {
     if (!s || !key) return NULL;
+    const char *value = NULL;
+    pthread_mutex_lock(&session_store_lock);
     for (int i = 0; i < s->data_count; i++) {
         if (strcmp(s->data[i].key, key) == 0) {
-            return s->data[i].value;
+            value = s->data[i].value;
+            break;
         }
     }
-    return NULL;
+    pthread_mutex_unlock(&session_store_lock);
+    return value;
 }
 
 void set_session_value(Session *s, const char *key, const char *value) {
     if (!s || !key || !value) return;
 
 	LOG_DEBUG("SESSION", "Setting session value: %s = %s", key, value);
+    pthread_mutex_lock(&session_store_lock);
     // Update existing key
     for (int i = 0; i < s->data_count; i++) {
         if (strcmp(s->data[i].key, key) == 0) {
-            free(s->data[i].value);
-            s->data[i].value = strdup(value);
+            // Another request may still read the old value
+            char *copy = strdup(value);
+            char **retired = copy ? realloc(s->retired, (s->retired_count + 1) * sizeof(*retired)) : NULL;
+            if (!retired) {
+                free(copy);
+                LOG_ERROR("SESSION", "Out of memory. Cannot set session value: %s", key);
+                pthread_mutex_unlock(&session_store_lock);
+                return;
+            }
+            s->retired = retired;
+            s->retired[s->retired_count++] = s->data[i].value;
+            s->data[i].value = copy;
+            pthread_mutex_unlock(&session_store_lock);
             return;
         }
     }
@@ -134,4 +202,5 @@ void set_session_value(Session *s, const char *key, const char *value) {
         s->data[s->data_count].value = strdup(value);
         s->data_count++;
     }
+    pthread_mutex_unlock(&session_store_lock);
 }
@@ -7,6 +7,7 @@
 
 #include <cweb/speedbench.h>
 #include <string.h>
+#include <pthread.h>
 
 #define SPEED_BENCHMARK_MAX_ACTIVE 256
 #define SPEED_BENCHMARK_HISTORY_CAPACITY 2048
@@ -25,6 +26,8 @@ static SpeedSample history_buffer[SPEED_BENCHMARK_HISTORY_CAPACITY];
 static SpeedSample history_snapshot[SPEED_BENCHMARK_HISTORY_CAPACITY];
 static size_t history_size = 0;
 static size_t history_next_index = 0;
+// Timers are started and stopped from every worker thread
+static pthread_mutex_t speedbench_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static clockid_t benchmark_clock(void) {
 #ifdef CLOCK_MONOTONIC_RAW
@@ -63,11 +66,13 @@ static ActiveTimer *get_free_timer_slot(void) {
 }
 
 void cweb_init_speedbench(void) {
+    pthread_mutex_lock(&speedbench_lock);
     memset(active_timers, 0, sizeof(active_timers));
     memset(history_buffer, 0, sizeof(history_buffer));
     memset(history_snapshot, 0, sizeof(history_snapshot));
     history_size = 0;
     history_next_index = 0;
+    pthread_mutex_unlock(&speedbench_lock);
 }
 
 void cweb_shutdown_speedbench(void) {
@@ -79,15 +84,6 @@ void cweb_speedbench_start(const void *key, const char *path) {
         return;
     }
 
-    ActiveTimer *slot = find_timer_slot(key);
-    if (!slot) {
-        slot = get_free_timer_slot();
-    }
-
-    if (!slot) {
-        return;
-    }
-
     struct timespec start_mono;
     struct timespec start_wall;
 
@@ -99,12 +95,24 @@ void cweb_speedbench_start(const void *key, const char *path) {
         return;
     }
 
+    pthread_mutex_lock(&speedbench_lock);
+    ActiveTimer *slot = find_timer_slot(key);
+    if (!slot) {
+        slot = get_free_timer_slot();
+    }
+
+    if (!slot) {
+        pthread_mutex_unlock(&speedbench_lock);
+        return;
+    }
+
     slot->in_use = 1;
     slot->key = key;
     strncpy(slot->path, path, SPEED_BENCHMARK_PATH_MAX - 1);
     slot->path[SPEED_BENCHMARK_PATH_MAX - 1] = '\0';
     slot->start_mono = start_mono;
     slot->start_wall = start_wall;
+    pthread_mutex_unlock(&speedbench_lock);
 }
 
 void cweb_speedbench_end(const void *key) {
@@ -112,11 +120,6 @@ void cweb_speedbench_end(const void *key) {
         return;
     }
 
-    ActiveTimer *slot = find_timer_slot(key);
-    if (!slot) {
-        return;
-    }
-
     struct timespec end_mono;
     struct timespec end_wall;
 
@@ -128,6 +131,13 @@ void cweb_speedbench_end(const void *key) {
         return;
     }
 
+    pthread_mutex_lock(&speedbench_lock);
+    ActiveTimer *slot = find_timer_slot(key);
+    if (!slot) {
+        pthread_mutex_unlock(&speedbench_lock);
+        return;
+    }
+
     SpeedSample sample;
     strncpy(sample.path, slot->path, SPEED_BENCHMARK_PATH_MAX);
     sample.path[SPEED_BENCHMARK_PATH_MAX - 1] = '\0';
@@ -144,11 +154,14 @@ void cweb_speedbench_end(const void *key) {
     slot->in_use = 0;
     slot->key = NULL;
     slot->path[0] = '\0';
+    pthread_mutex_unlock(&speedbench_lock);
 }
 
 const SpeedSample *cweb_get_speed_history(size_t *out_count) {
+    pthread_mutex_lock(&speedbench_lock);
     size_t count = history_size;
     if (count == 0) {
+        pthread_mutex_unlock(&speedbench_lock);
         if (out_count) {
             *out_count = 0;
         }
@@ -160,6 +173,7 @@ const SpeedSample *cweb_get_speed_history(size_t *out_count) {
         size_t idx = (start_index + i) % SPEED_BENCHMARK_HISTORY_CAPACITY;
         history_snapshot[i] = history_buffer[idx];
     }
+    pthread_mutex_unlock(&speedbench_lock);
 
     if (out_count) {
         *out_count = count;
@@ -113,13 +113,16 @@ void cweb_auto_compress(Request *req, Response *res) {
 	char *minified = NULL;
 	size_t minified_len = 0;
 
-	cweb_minify_asset(res->body, res->body_len, cweb_get_response_header(res, "Content-Type"), &minified, &minified_len);
+	cweb_minify_asset(res->body, res->body_len, cweb_get_response_header_id(res, CWEB_HEADER_CONTENT_TYPE), &minified, &minified_len);
 	if (minified && minified_len > 0 && minified_len < res->body_len) {
 		LOG_DEBUG("SEND_RESPONSE", "Minified %zu -> %zu", res->body_len, minified_len);
-        cweb_leak_tracker_record("res.body", res->body, res->body_len, false);
-		free(res->body);
+		if (!res->isliteral) {
+			cweb_leak_tracker_record("res.body", res->body, res->body_len, false);
+			free(res->body);
+		}
 		res->body = minified;
 		res->body_len = minified_len;
+		res->isliteral = 0; // Body is owned by the response now
         cweb_leak_tracker_record("res->body", res->body, res->body_len, true);
 	}
 	else {
@@ -130,7 +133,7 @@ void cweb_auto_compress(Request *req, Response *res) {
     const size_t MIN_COMPRESS_SIZE = 4096;
     if (res->body_len < MIN_COMPRESS_SIZE) return;
 
-    const char *accept_enc = cweb_get_request_header(req, "Accept-Encoding");
+    const char *accept_enc = cweb_get_request_header_id(req, CWEB_HEADER_ACCEPT_ENCODING);
     CompressionType chosen = cweb_pick_compression(accept_enc);
     if (chosen == COMP_NONE) return;
 
@@ -146,10 +149,13 @@ void cweb_auto_compress(Request *req, Response *res) {
     if (rc == 0 && compressed && compressed_len > 0 && compressed_len < res->body_len) {
         LOG_DEBUG("SEND_RESPONSE", "%s compressed %zu -> %zu",
                   (chosen == COMP_BR ? "Brotli" : "Gzip"), res->body_len, compressed_len);
-        cweb_leak_tracker_record("res.body", res->body, res->body_len, false);
-        free(res->body);
+        if (!res->isliteral) {
+            cweb_leak_tracker_record("res.body", res->body, res->body_len, false);
+            free(res->body);
+        }
         res->body = compressed;
         res->body_len = compressed_len;
+        res->isliteral = 0;
         cweb_leak_tracker_record("res->body", res->body, res->body_len, true);
         cweb_add_response_header(res, "Content-Encoding", chosen == COMP_BR ? "br" : "gzip");
         cweb_add_response_header(res, "Vary", "Accept-Encoding");
@@ -34,6 +34,7 @@ void cweb_fileserver_destroy() {
 
 void cweb_fileserver_clear_cache() {
     for (int i = 0; i < cache_count; i++) {
+        fileserver_release_variants(&file_cache[i]);
         if (file_cache[i].data) {
             cweb_leak_tracker_record("cached->data",  file_cache[i].data,  file_cache[i].size, false);
             free(file_cache[i].data);
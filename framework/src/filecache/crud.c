@@ -146,7 +146,7 @@ int cweb_fileserver_load_cache(const char *cache_file) {
 
         file_cache[i].size = (size_t)data_size;
         file_cache[i].last_modified = (time_t)last_mod;
-        file_cache[i].is_loaded = true;
+        file_cache[i].is_loaded = fileserver_build_variants(&file_cache[i]) == 0;
         cache_count++;
     }
 
@@ -173,8 +173,8 @@ int update_filechache(const char *path) {
 			LOG_DEBUG("FILESERVER", "File modified, reloading: %s", full_path);
             // File was modified, reload it
             
-            // Remove from cache and reload
-            free(cached->data);
+            // Reload into a new entry. Responses in flight may still send
+            // the old one's variants, they go with the next clear_cache
             cached->is_loaded = false;
             
             if (cweb_load_file_to_cache(full_path, path) == 0) {
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/fileserver.h>
+#include "fileserver_internal.h"
+#include <cweb/leak_detector.h>
+#include <cweb/logger.h>
+#include <cweb/thread_local.h>
+#include <event2/buffer.h>
+#include <fcntl.h>
+
+// Open files served from the filesystem, kept as libevent file segments so
+// the body goes out through sendfile. Each worker thread has its own table;
+// segments are refcounted, so evicting one never breaks a queued response.
+
+#define MAX_OPEN_FILES 64
+#define OPEN_FILE_REVALIDATE_SECS 1
+
+typedef struct {
+    char *path;
+    struct evbuffer_file_segment *segment;
+    off_t size;
+    time_t last_modified;
+    ino_t inode;
+    time_t checked;             // Last stat() of path
+    unsigned long last_used;
+} OpenFile;
+
+static CWEB_THREAD_LOCAL OpenFile open_files[MAX_OPEN_FILES];
+static CWEB_THREAD_LOCAL unsigned long open_file_clock = 0;
+static unsigned open_file_flags = EVBUF_FS_CLOSE_ON_FREE; // Set before the workers start
+
+static void open_file_release(OpenFile *entry) {
+    if (entry->segment) {
+        evbuffer_file_segment_free(entry->segment); // Closes the fd once unreferenced
+    }
+    if (entry->path) {
+        cweb_leak_tracker_record("open_file.path", entry->path, strlen(entry->path) + 1, false);
+        free(entry->path);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+static OpenFile *open_file_lookup(const char *filepath) {
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (open_files[i].path && strcmp(open_files[i].path, filepath) == 0) {
+            return &open_files[i];
+        }
+    }
+    return NULL;
+}
+
+// Free slot, or the least recently used one
+static OpenFile *open_file_slot(void) {
+    OpenFile *victim = &open_files[0];
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (!open_files[i].path) return &open_files[i];
+        if (open_files[i].last_used < victim->last_used) victim = &open_files[i];
+    }
+    LOG_DEBUG("FILESERVER", "Evicting open file %s", victim->path);
+    open_file_release(victim);
+    return victim;
+}
+
+static int open_file_fill(OpenFile *entry, const char *filepath) {
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+
+    struct evbuffer_file_segment *segment = evbuffer_file_segment_new(fd, 0, st.st_size, open_file_flags);
+    if (!segment) {
+        close(fd);
+        return -1;
+    }
+
+    entry->path = strdup(filepath);
+    if (!entry->path) {
+        evbuffer_file_segment_free(segment);
+        return -1;
+    }
+    cweb_leak_tracker_record("open_file.path", entry->path, strlen(entry->path) + 1, true);
+    entry->segment = segment;
+    entry->size = st.st_size;
+    entry->last_modified = st.st_mtime;
+    entry->inode = st.st_ino;
+    entry->checked = time(NULL);
+    return 0;
+}
+
+// Drop the entry if the file on disk was changed or replaced
+static void open_file_revalidate(OpenFile *entry) {
+    time_t now = time(NULL);
+    if (now - entry->checked < OPEN_FILE_REVALIDATE_SECS) return;
+    entry->checked = now;
+
+    struct stat st;
+    if (stat(entry->path, &st) != 0 || st.st_ino != entry->inode ||
+        st.st_size != entry->size || st.st_mtime != entry->last_modified) {
+        LOG_DEBUG("FILESERVER", "Open file changed on disk: %s", entry->path);
+        open_file_release(entry);
+    }
+}
+
+int fdcache_add_file(const char *filepath, struct evbuffer *out, size_t *size) {
+    if (!filepath || !out) return -1;
+
+    OpenFile *entry = open_file_lookup(filepath);
+    if (entry) {
+        open_file_revalidate(entry);
+    }
+    if (!entry || !entry->segment) {
+        entry = open_file_slot();
+        if (open_file_fill(entry, filepath) != 0) {
+            return -1;
+        }
+    }
+
+    entry->last_used = ++open_file_clock;
+    if (entry->size > 0 && evbuffer_add_file_segment(out, entry->segment, 0, entry->size) != 0) {
+        return -1;
+    }
+    *size = (size_t)entry->size;
+    return 0;
+}
+
+void fdcache_disable_sendfile(void) {
+    open_file_flags |= EVBUF_FS_DISABLE_SENDFILE;
+}
+
+void cweb_fileserver_release_open_files(void) {
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (open_files[i].path) {
+            open_file_release(&open_files[i]);
+        }
+    }
+}
@@ -12,7 +12,8 @@
 CachedFile* cweb_find_cached_file(const char *filename) {
 	LOG_DEBUG("FILESERVER", "Searching cache for file: %s", filename);
     for (int i = 0; i < cache_count; i++) {
-        if (strcmp(file_cache[i].filename, filename) == 0) {
+        // Reloaded files leave their old entry behind, unloaded
+        if (file_cache[i].is_loaded && strcmp(file_cache[i].filename, filename) == 0) {
             return &file_cache[i];
         }
     }
@@ -72,8 +73,8 @@ int cweb_load_file_to_cache(const char *filepath, const char *relative_path) {
     cached->data = data;
     cached->size = file_size;
     cached->last_modified = st.st_mtime;
-    cached->is_loaded = true;
     cweb_leak_tracker_record(" cached->data",  cached->data,  cached->size, true);
+    cached->is_loaded = fileserver_build_variants(cached) == 0;
 
     cache_count++;
     printf("Cached file: %s (%zu bytes)\n", relative_path, cached->size);
@@ -30,6 +30,16 @@ extern bool initialized;
 int scan_directory_recursive(const char *dir_path, const char *base_path);
 int update_filechache(const char *path);
 
+/* Encoded bodies and header blocks of a cached file (variants.c) */
+int fileserver_build_variants(CachedFile *cached);
+void fileserver_release_variants(CachedFile *cached);
+
+/* Open-fd cache (fdcache.c), appends the file to out as a sendfile segment */
+struct evbuffer;
+int fdcache_add_file(const char *filepath, struct evbuffer *out, size_t *size);
+/* Map files instead of sendfile, for transports that send from memory (io_uring) */
+void fdcache_disable_sendfile(void);
+
 
 /* Read Write utils */
 int write_bytes(FILE *f, const void *buf, size_t len);
@@ -42,6 +52,7 @@ int read_u64_le(FILE *f, uint64_t *out);
 
 /* is-er */
 bool is_excluded_path(const char *rel_path);
+bool is_text_asset(const char *mime_type);
 bool is_le(void);
 bool cweb_is_file_modified(const char *filepath, time_t cached_time);
 
@@ -47,6 +47,12 @@ const char* cweb_get_mime_type(const char *filename) {
     return "application/octet-stream";
 }
 
+// Text assets are read into memory so they can be minified and compressed
+bool is_text_asset(const char *mime_type) {
+    return strncmp(mime_type, "text/", 5) == 0 || strstr(mime_type, "javascript") ||
+           strstr(mime_type, "json") || strstr(mime_type, "xml");
+}
+
 bool is_excluded_path(const char *rel_path) {
     if (!rel_path || server_config.exclude_count == 0) return false;
     for (size_t i = 0; i < server_config.exclude_count; i++) {
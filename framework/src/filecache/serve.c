@@ -8,6 +8,7 @@
 #include <cweb/fileserver.h>
 #include "fileserver_internal.h"
 #include <cweb/leak_detector.h>
+#include <event2/buffer.h>
 
 // Normalize incoming URL paths to cache keys so /assets/foo -> /foo etc.
 static char* normalize_cache_path(const char *url_path) {
@@ -26,8 +27,36 @@ static char* normalize_cache_path(const char *url_path) {
 }
 
 
+// Everything else goes from the page cache to the socket without a copy
+static int serve_file_segment(const char *filepath, const char *mime_type, Response *res) {
+    struct evbuffer *body = evbuffer_new();
+    if (!body) return -1;
+
+    size_t size = 0;
+    if (fdcache_add_file(filepath, body, &size) != 0) {
+        evbuffer_free(body);
+        return -1;
+    }
+    cweb_leak_tracker_record("res.body_file", body, size, true);
+
+    res->status_code = 200;
+    res->priority = get_resource_priority(filepath);
+    cweb_add_response_header(res, "Content-Type", mime_type);
+	cweb_add_response_header(res, "Cache-Control", "public, max-age=31536000");
+    res->body_file = body;
+    res->body_len = size;
+	res->state = PROCESSED;
+	LOG_DEBUG("FILESERVER", "State PROCESSED file via sendfile: %s (%zu bytes)", filepath, res->body_len);
+    return 0;
+}
+
 int cweb_serve_from_filesystem(const char *filepath, Response *res) {
 	LOG_DEBUG("FILESERVER", "Serving from filesystem: %s", filepath);
+    const char *mime_type = cweb_get_mime_type(filepath);
+    if (!is_text_asset(mime_type)) {
+        return serve_file_segment(filepath, mime_type, res);
+    }
+
     AUTOFREE_CLOSE_FILE FILE *file = fopen(filepath, "rb");
     if (!file) {
         return -1; // File not found
@@ -54,7 +83,6 @@ int cweb_serve_from_filesystem(const char *filepath, Response *res) {
         return -1;
     }
 
-    const char *mime_type = cweb_get_mime_type(filepath);
     res->status_code = 200;
     res->priority = get_resource_priority(filepath);
     cweb_add_response_header(res, "Content-Type", mime_type);
@@ -67,6 +95,34 @@ int cweb_serve_from_filesystem(const char *filepath, Response *res) {
     return 0;
 }
 
+// Sends the variant for the client's Accept-Encoding (identity without a
+// request) straight from the cache: the body and the header block are
+// shared, nothing is copied or formatted per request
+static int serve_cached(const Request *req, const char *path, Response *res) {
+    CachedFile *cached = cweb_find_cached_file(path);
+    if (!cached || !cached->is_loaded) {
+		LOG_ERROR("FILESERVER", "File not found in cache: %s", path);
+        return -1; // Not found in cache
+    }
+
+	// not non-blockign at the moment. will do it later, no review about that needed now
+	// update_filechache(path);
+
+    CompressionType encoding = req ? cweb_pick_compression(cweb_get_request_header_id(req, CWEB_HEADER_ACCEPT_ENCODING)) : COMP_NONE;
+    const CachedVariant *variant = &cached->variants[encoding];
+    if (!variant->data) variant = &cached->variants[COMP_NONE];
+
+	res->status_code = 200;
+    res->priority = get_resource_priority(path);
+    res->body = variant->data;
+    res->body_len = variant->size;
+    res->isliteral = 1; // Owned by the cache
+    res->header_block = variant->headers;
+	res->state = PROCESSED;
+	LOG_DEBUG("FILESERVER", "State PROCESSED file from memory: %s (%zu bytes)", path, res->body_len);
+    return 0;
+}
+
 void cweb_fileserver_handle_request(Request *req, Response *res) {
     if (!initialized) {
         res->status_code = 500;
@@ -100,15 +156,15 @@ void cweb_fileserver_handle_request(Request *req, Response *res) {
     
     switch (server_config.mode) {
         case FILESERVER_MODE_MEMORY:
-            result = cweb_serve_from_memory(path, res);
+            result = serve_cached(req, path, res);
             break;
             
         case FILESERVER_MODE_FILESYSTEM:
             if (server_config.static_dir) {
-				LOG_DEBUG("FILESERVER", "Serving from filesystem: %s", path);
+				LOG_DEBUG("FILESERVER", "Serving from filesystem: %s", lookup_path);
                 AUTOFREE char *full_path = NULL;
-                if (asprintf(&full_path, "%s%s", server_config.static_dir, path) < 0) {
-                    LOG_ERROR("FILESERVER", "Failed to build static path for %s", path ? path : "(null)");
+                if (asprintf(&full_path, "%s%s", server_config.static_dir, lookup_path) < 0) {
+                    LOG_ERROR("FILESERVER", "Failed to build static path for %s", lookup_path);
                     res->status_code = 500;
                     res->body = strdup("Internal Server Error");
                     res->body_len = strlen(res->body);
@@ -121,7 +177,7 @@ void cweb_fileserver_handle_request(Request *req, Response *res) {
             
         case FILESERVER_MODE_HYBRID:
             // Try memory first, fallback to filesystem
-            result = cweb_serve_from_memory(lookup_path, res);
+            result = serve_cached(req, lookup_path, res);
             if (result != 0 && server_config.static_dir) {
                 AUTOFREE char *full_path = NULL;
                 if (asprintf(&full_path, "%s%s", server_config.static_dir, lookup_path) < 0) {
@@ -146,34 +202,5 @@ void cweb_fileserver_handle_request(Request *req, Response *res) {
 }
 
 int cweb_serve_from_memory(const char *path, Response *res) {
-    
-    CachedFile *cached = cweb_find_cached_file(path);
-    if (!cached || !cached->is_loaded) {
-		LOG_ERROR("FILESERVER", "File not found in cache: %s", path);
-        return -1; // Not found in cache
-    }
-
-
-	// not non-blockign at the moment. will do it later, no review about that needed now
-	// update_filechache(path);
-
-    // Serve from cache
-
-    
-    // Copy data (don't give direct pointer to avoid issues)
-    res->body = malloc(cached->size);
-    if (res->body) {
-        memcpy(res->body, cached->data, cached->size);
-        res->body_len = cached->size;
-    }
-	res->status_code = 200;
-    res->priority = get_resource_priority(path);
-    cweb_add_response_header(res, "Content-Type", cached->mime_type);
-	cweb_add_response_header(res, "Cache-Control", "public, max-age=31536000");
-    // cweb_add_performance_headers(res, cached->mime_type);
-     cweb_leak_tracker_record("res->body", res->body, res->body_len, true);
-	res->state = PROCESSED;
-	LOG_DEBUG("FILESERVER", "State PROCESSED file from memory: %s (%zu bytes)", path, cached->size);
-    
-    return res->body ? 0 : -1;
+    return serve_cached(NULL, path, res);
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+ * Copyright 2025 Ben Bohle
+ * Licensed under the Apache License, Version 2.0
+ * http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+#include <cweb/fileserver.h>
+#include "fileserver_internal.h"
+#include <cweb/leak_detector.h>
+
+// Same thresholds as server_prepare_response / cweb_auto_compress apply per request
+#define VARIANT_MIN_MINIFY 512
+#define VARIANT_MIN_COMPRESS 4096
+
+static CwebHeaderBlock *variant_headers(const CachedFile *cached, bool vary, const char *encoding) {
+    Response *res = cweb_create_response();
+    if (!res) return NULL;
+    cweb_add_response_header(res, "Content-Type", cached->mime_type);
+    cweb_add_response_header(res, "Cache-Control", "public, max-age=31536000");
+    if (vary) cweb_add_response_header(res, "Vary", "Accept-Encoding");
+    if (encoding) cweb_add_response_header(res, "Content-Encoding", encoding);
+    CwebHeaderBlock *block = cweb_header_block_new(res);
+    cweb_free_http_response(res);
+    return block;
+}
+
+// Minifies and compresses once what every request used to redo, and
+// serializes the headers of each encoding that pays off
+int fileserver_build_variants(CachedFile *cached) {
+    CachedVariant *identity = &cached->variants[COMP_NONE];
+    identity->data = cached->data;
+    identity->size = cached->size;
+
+    if (is_text_asset(cached->mime_type) && cached->size > VARIANT_MIN_MINIFY) {
+        char *minified = NULL;
+        size_t minified_len = 0;
+        cweb_minify_asset(cached->data, cached->size, cached->mime_type, &minified, &minified_len);
+        if (minified && minified_len > 0 && minified_len < cached->size) {
+            cweb_leak_tracker_record("cached.variant", minified, minified_len, true);
+            identity->data = minified;
+            identity->size = minified_len;
+        } else {
+            free(minified);
+        }
+
+        if (identity->size >= VARIANT_MIN_COMPRESS) {
+            char *out = NULL;
+            size_t out_len = 0;
+            if (cweb_brotli(identity->data, identity->size, &out, &out_len) == 0 && out && out_len < identity->size) {
+                cweb_leak_tracker_record("cached.variant", out, out_len, true);
+                cached->variants[COMP_BR].data = out;
+                cached->variants[COMP_BR].size = out_len;
+            } else {
+                free(out);
+            }
+            out = NULL;
+            if (cweb_gzip(identity->data, identity->size, &out, &out_len) == 0 && out && out_len < identity->size) {
+                cweb_leak_tracker_record("cached.variant", out, out_len, true);
+                cached->variants[COMP_GZIP].data = out;
+                cached->variants[COMP_GZIP].size = out_len;
+            } else {
+                free(out);
+            }
+        }
+    }
+
+    bool vary = cached->variants[COMP_BR].data || cached->variants[COMP_GZIP].data;
+    identity->headers = variant_headers(cached, vary, NULL);
+    if (cached->variants[COMP_BR].data) cached->variants[COMP_BR].headers = variant_headers(cached, true, "br");
+    if (cached->variants[COMP_GZIP].data) cached->variants[COMP_GZIP].headers = variant_headers(cached, true, "gzip");
+
+    for (int i = COMP_NONE; i <= COMP_GZIP; i++) {
+        if (cached->variants[i].data && !cached->variants[i].headers) {
+            fileserver_release_variants(cached);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void fileserver_release_variants(CachedFile *cached) {
+    for (int i = COMP_NONE; i <= COMP_GZIP; i++) {
+        CachedVariant *v = &cached->variants[i];
+        if (v->data && v->data != cached->data) {
+            cweb_leak_tracker_record("cached.variant", v->data, v->size, false);
+            free(v->data);
+        }
+        cweb_header_block_free(v->headers);
+        v->data = NULL;
+        v->size = 0;
+        v->headers = NULL;
+    }
+}
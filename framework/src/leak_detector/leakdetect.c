@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 typedef struct {
     const void *pointer;
@@ -23,6 +24,7 @@ static LeakRecord *g_records = NULL;
 static size_t g_record_count = 0;
 static size_t g_record_capacity = 0;
 static bool g_exit_handler_registered = false;
+static pthread_mutex_t g_records_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static void leak_tracker_atexit(void);
 
@@ -99,6 +101,7 @@ void cweb_leak_tracker_record(const char *name, const void *pointer, size_t size
               size,
               name ? name : "<unnamed>");
 
+    pthread_mutex_lock(&g_records_lock);
     register_atexit_handler();
 
     size_t index = find_record_index(pointer);
@@ -132,10 +135,13 @@ void cweb_leak_tracker_record(const char *name, const void *pointer, size_t size
             --g_record_count;
         }
     }
+    pthread_mutex_unlock(&g_records_lock);
 }
 
-size_t cweb_leak_tracker_outstanding(void) {;
+size_t cweb_leak_tracker_outstanding(void) {
+    pthread_mutex_lock(&g_records_lock);
     size_t count = g_record_count;
+    pthread_mutex_unlock(&g_records_lock);
     return count;
 }
 
@@ -145,7 +151,10 @@ void cweb_leak_tracker_dump(void) {
     }
 
     LOG_ERROR("LEAK", "Leak tracker dump requested");
+    // Other workers record while this walks the table, ensure_capacity may move it
+    pthread_mutex_lock(&g_records_lock);
     if (g_record_count == 0) {
+        pthread_mutex_unlock(&g_records_lock);
         LOG_INFO("LEAK", "No outstanding allocations detected");
         return;
     }
@@ -160,6 +169,7 @@ void cweb_leak_tracker_dump(void) {
                     record->size,
                     record->name ? record->name : "<unnamed>");
     }
+    pthread_mutex_unlock(&g_records_lock);
     LOG_WARNING("LEAK", "Total leaked memory: %zu byte(s)", total_bytes);
 }
 
@@ -168,6 +178,7 @@ void cweb_leak_tracker_reset(void) {
         return;
     }
 
+    pthread_mutex_lock(&g_records_lock);
     for (size_t i = 0; i < g_record_count; ++i) {
         free_record(&g_records[i]);
     }
@@ -175,11 +186,11 @@ void cweb_leak_tracker_reset(void) {
     g_records = NULL;
     g_record_count = 0;
     g_record_capacity = 0;
-
+    pthread_mutex_unlock(&g_records_lock);
 }
 
 static void leak_tracker_atexit(void) {
-    bool has_leaks = g_record_count > 0;
+    bool has_leaks = cweb_leak_tracker_outstanding() > 0;
 
     if (has_leaks) {
         cweb_leak_tracker_dump();
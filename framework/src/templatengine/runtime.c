@@ -10,8 +10,8 @@
 #include <strings.h>
 #include <cweb/leak_detector.h>
 
-// Global output buffer
-cweb_buffer_t g_output_buffer = {0};
+// Output buffer, one per worker thread
+CWEB_THREAD_LOCAL cweb_buffer_t g_output_buffer = {0};
 
 void cweb_buffer_init(cweb_buffer_t *buffer) {
     if (!buffer) return;
@@ -0,0 +1,93 @@
+// Checks that HEAD answers with the same head as GET (RFC 9110 9.3.2).
+//
+//   gcc -O2 -o headcheck headcheck.c
+//   ./app 8080 1   &   ./headcheck 8080 /page.html
+//
+// Sends GET and then HEAD for <path> to 127.0.0.1:<port>, both with
+// Accept-Encoding: gzip, and compares the status lines and headers (Date
+// aside). Use a compressible path with a body over 512 bytes to cover
+// Content-Encoding, Vary and the compressed Content-Length. Exits 1 on a
+// difference.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define HEAD_MAX 16384
+
+static int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sin = {0};
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// Reads the response head for method into head, without the Date line
+static void fetch_head(int port, const char *method, const char *path, char *head) {
+    int fd = connect_to(port);
+    char request[1024];
+    int len = snprintf(request, sizeof(request),
+                       "%s %s HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\nConnection: close\r\n\r\n",
+                       method, path);
+    if (len < 0 || (size_t)len >= sizeof(request) || write(fd, request, len) != len) {
+        fprintf(stderr, "%s: could not send the request\n", method);
+        exit(1);
+    }
+
+    char raw[HEAD_MAX];
+    size_t used = 0;
+    char *end = NULL;
+    while (!end && used < sizeof(raw) - 1) {
+        ssize_t n = read(fd, raw + used, sizeof(raw) - 1 - used);
+        if (n <= 0) break;
+        used += (size_t)n;
+        raw[used] = '\0';
+        end = strstr(raw, "\r\n\r\n");
+    }
+    close(fd);
+    if (!end) {
+        fprintf(stderr, "%s: no complete response head\n", method);
+        exit(1);
+    }
+    end[2] = '\0';
+
+    head[0] = '\0';
+    for (char *line = raw; *line; ) {
+        char *next = strstr(line, "\r\n") + 2;
+        if (strncasecmp(line, "Date:", 5) != 0) {
+            strncat(head, line, (size_t)(next - line));
+        }
+        line = next;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <port> <path>\n", argv[0]);
+        return 2;
+    }
+    int port = atoi(argv[1]);
+    const char *path = argv[2];
+
+    static char get_head[HEAD_MAX], head_head[HEAD_MAX];
+    fetch_head(port, "GET", path, get_head);
+    fetch_head(port, "HEAD", path, head_head);
+
+    if (strcmp(get_head, head_head) != 0) {
+        printf("HEAD %s differs from GET\n--- GET\n%s--- HEAD\n%s", path, get_head, head_head);
+        return 1;
+    }
+    printf("HEAD %s matches GET\n%s", path, get_head);
+    return 0;
+}